@@ -1,6 +1,12 @@
+#include <mutex>
+#include <atomic>
+#include <thread>
 #include <sstream>
+#include <iomanip>
+#include <exception>
 #include <experimental/filesystem>
 #include "convert/convert.h"
+#include "convert/regrid.h"
 
 namespace {
 
@@ -13,53 +19,259 @@ namespace {
       return fs::absolute(path).string();
    };
 
+   static constexpr auto MANIFEST = "convert.manifest.json";
+   static constexpr auto COMBINED = "combined.json";
+
+   struct Options {
+      double max_error = -1;
+      bool regrid = false;
+      convert::RegridOptions regrid_options{};
+      size_t threads = 0;
+
+      // anything that changes the output of a conversion
+      std::string signature() const {
+         std::ostringstream os{};
+         // round-trip precision, so options differing in any digit hash differently
+         os << std::setprecision(17);
+         os << max_error << ";" << regrid << ";";
+         os << static_cast<int>(regrid_options.mode) << ";" << regrid_options.tolerance;
+         return os.str();
+      }
+   };
+
+   struct Source {
+      std::string csv{};     // absolute path of the input
+      std::string key{};     // path relative to the data directory (manifest key)
+      std::string name{};    // table name in the combined map
+      std::string json{};    // absolute path of the converted table
+      std::string hash{};
+      size_t dims = 0;
+      bool skipped = false;
+      json_t table{};
+   };
+
+   // FNV-1a (64 bit) over the file contents and the conversion options
+   std::string content_hash(const std::string& path, const std::string& signature) {
+      std::ifstream ifs(path, std::ios::binary);
+      std::uint64_t hash = 0xcbf29ce484222325ULL;
+      auto mix = [&](unsigned char c) {
+         hash = (hash ^ c) * 0x100000001b3ULL;
+      };
+      using iterator_t = std::istreambuf_iterator<char>;
+      for (auto it = iterator_t(ifs); it != iterator_t(); ++it) {
+         mix(static_cast<unsigned char>(*it));
+      }
+      for (const auto c : signature) {
+         mix(static_cast<unsigned char>(c));
+      }
+      std::ostringstream os{};
+      os << std::hex << hash;
+      return os.str();
+   }
+
+   // every *.csv below 'root'; '<dir>/data.csv' keeps its historical name 'table<dir>'
+   std::vector<Source> discover(const fs::path& root) {
+      std::vector<Source> sources{};
+      for (const auto& entry : fs::recursive_directory_iterator(root)) {
+         const auto& path = entry.path();
+         if (!fs::is_regular_file(path) || path.extension() != ".csv") continue;
+         auto relative = path.string().substr(root.string().size());
+         while (!relative.empty() && (relative.front() == '/' || relative.front() == '\\')) {
+            relative.erase(0, 1);
+         }
+         Source source{};
+         source.csv = fs::absolute(path).string();
+         source.key = relative;
+         source.name = relative.substr(0, relative.size() - path.extension().string().size());
+         const std::string suffix = "data";
+         const auto n = source.name.size();
+         if (n > suffix.size() && source.name.compare(n - suffix.size(), suffix.size(), suffix) == 0
+            && (source.name[n - suffix.size() - 1] == '/' || source.name[n - suffix.size() - 1] == '\\')) {
+            source.name = "table" + source.name.substr(0, n - suffix.size() - 1);
+         }
+         auto json = path;
+         source.json = fs::absolute(json.replace_extension(".json")).string();
+         sources.emplace_back(std::move(source));
+      }
+      std::sort(std::begin(sources), std::end(sources), [](const auto& a, const auto& b) {
+         return a.key < b.key;
+      });
+      return sources;
+   }
+
+   template<class Table>
+   json_t convert_table(const csv::CSV& csv, const Source& source, const Options& options, std::ostream& log) {
+      using convert::load;
+      Table table{};
+      load(csv, table);
+      if (options.regrid) {
+         convert::RegridReport report{};
+         auto regridded = convert::regrid(table, options.regrid_options, report);
+         // decided on the table shapes only (the timings are too noisy to pick outputs by): within
+         // tolerance, and either no larger or at most twice the size for more directly indexed axes
+         const auto applied = report.converged
+            && (report.bytes_after <= report.bytes_before
+               || (report.uniform_after > report.uniform_before && report.bytes_after <= 2 * report.bytes_before));
+         if (applied) {
+            table = std::move(regridded);
+         }
+         json_t json = report;
+         json["applied"] = applied;
+         auto path = fs::path(source.csv);
+         save_file(path.replace_extension(".regrid.json").string(), json);
+         log << source.csv << ": " << json.dump() << "\n";
+      }
+      if (options.max_error >= 0) {
+         const auto bytes = table.footprint();
+         if (table.compress(options.max_error)) {
+            log << source.csv << ": max error " << table.error();
+            log << " (limit " << options.max_error << "), ";
+            log << bytes << " -> " << table.footprint() << " bytes\n";
+         }
+         else {
+            log << source.csv << ": compression would not shrink the table (";
+            log << bytes << " bytes), kept as a grid\n";
+         }
+      }
+      json_t json{};
+      json = table;
+      return json;
+   }
+
+   void convert_source(Source& source, const Options& options, std::ostream& log) {
+      const auto csv = csv::load_file(source.csv);
+      source.dims = csv.headers.size() - 1;
+      switch (source.dims) {
+      case 1:
+         source.table = convert_table<table<1>>(csv, source, options, log);
+         break;
+      case 2:
+         source.table = convert_table<table<2>>(csv, source, options, log);
+         break;
+      case 3:
+         source.table = convert_table<table<3>>(csv, source, options, log);
+         break;
+      case 4:
+         source.table = convert_table<table<4>>(csv, source, options, log);
+         break;
+      case 5:
+         source.table = convert_table<table<5>>(csv, source, options, log);
+         break;
+      default:
+         throw std::runtime_error(source.csv + ": unsupported number of columns.");
+      }
+      save_file(source.json, source.table);
+   }
 }
 
 int main(int argc, char** argv) {
-   if (argc != 2) {
+   if (argc < 2 || (argc % 2) != 0) {
       std::ostringstream os{};
       os << "Usage:\n";
-      os << "\tArg 1: Path to data directory (2d, 3d, 4d directories).";
+      os << "\tArg 1: Path to data directory (every *.csv below it is converted).\n";
+      os << "\t[--compress <max error>]: Store tables block-compressed within <max error>.\n";
+      os << "\t[--regrid <uniform|adaptive>]: Resample tables onto new axes (report: <name>.regrid.json).\n";
+      os << "\t[--tolerance <max error>]: Maximum regridding error (default 0).\n";
+      os << "\t[--threads <count>]: Worker threads (default: hardware concurrency).";
       throw std::runtime_error(os.str());
    }
 
+   Options options{};
+   for (auto i = 2; i + 1 < argc; i += 2) {
+      const std::string option = argv[i];
+      const std::string value = argv[i + 1];
+      if (option == "--compress") {
+         options.max_error = std::stod(value);
+      }
+      else if (option == "--regrid" && (value == "uniform" || value == "adaptive")) {
+         options.regrid = true;
+         options.regrid_options.mode = (value == "uniform") ? convert::RegridMode::Uniform : convert::RegridMode::Adaptive;
+      }
+      else if (option == "--tolerance") {
+         options.regrid_options.tolerance = std::stod(value);
+      }
+      else if (option == "--threads") {
+         options.threads = std::stoul(value);
+      }
+      else {
+         throw std::runtime_error("Unknown option: " + option + " " + value);
+      }
+   }
+
    const auto root = fs::path(argv[1]);
-   strings_t DIRS{
-      get_path(root, "2d"),
-      get_path(root, "3d"),
-      get_path(root, "4d"),
-   };
+   auto sources = discover(root);
 
-   std::vector<std::string> csvs{};
-   std::vector<std::string> jsons{};
-   auto convert = [&](size_t index, auto table) {
-      using namespace std::string_literals;
-      using convert::load;
-      csvs.emplace_back(get_path(DIRS[index], "data.csv"s));
-      auto csv = csv::load_file(csvs.back());
-      load(csv, table);
-      json_t json{};
-      json = table;
-      jsons.emplace_back(get_path(DIRS[index], "data.json"s));
-      save_file(jsons.back(), json);
-   };
+   // inputs whose contents (and options) hash like last time keep their converted table
+   const auto manifest_path = get_path(root, MANIFEST);
+   json_t manifest = json_t::object();
+   if (fs::exists(manifest_path)) {
+      manifest = load_file(manifest_path);
+   }
+   const auto signature = options.signature();
+   std::vector<Source*> pending{};
+   for (auto& source : sources) {
+      source.hash = content_hash(source.csv, signature);
+      const auto it = manifest.find(source.key);
+      source.skipped = (it != manifest.end()) && (*it == source.hash) && fs::exists(source.json);
+      if (!source.skipped) {
+         pending.emplace_back(&source);
+      }
+   }
 
-   convert(0, table<2>{});
-   convert(1, table<3>{});
-   convert(2, table<4>{});
+   auto threads = options.threads;
+   if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1U);
+   }
+   const auto workers = std::max(std::min(threads, pending.size()), size_t{ 1 });
+   options.regrid_options.threads = std::max(threads / workers, size_t{ 1 });
 
-   table_map map1{};
-   map1.emplace("table2d", load_file(jsons[0]).get<table<2>>());
-   map1.emplace("table3d", load_file(jsons[1]).get<table<3>>());
-   map1.emplace("table4d", load_file(jsons[2]).get<table<4>>());
-   json_t json1{};
-   json1 = map1;
-   const auto combined = get_path(root, "combined.json");
-   save_file(combined, json1);
+   std::atomic<size_t> next{ 0 };
+   std::mutex mutex{};
+   std::exception_ptr failure{};
+   auto work = [&]() {
+      for (auto i = next++; i < pending.size(); i = next++) {
+         std::ostringstream log{};
+         try {
+            convert_source(*pending[i], options, log);
+         }
+         catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure) failure = std::current_exception();
+         }
+         std::lock_guard<std::mutex> lock(mutex);
+         std::cout << log.str();
+      }
+   };
+   std::vector<std::thread> pool{};
+   for (auto i = 0U; i < workers; ++i) {
+      pool.emplace_back(work);
+   }
+   for (auto& thread : pool) {
+      thread.join();
+   }
+   if (failure) {
+      std::rethrow_exception(failure);
+   }
 
-   auto json2 = load_file(combined);
-   auto map2 = json2.get<table_map>();
+   // combined map straight from the converted documents (same layout as to_json(table_map))
+   json_t combined = json_t::array();
+   manifest = json_t::object();
+   for (auto& source : sources) {
+      if (source.skipped) {
+         source.table = load_file(source.json);
+         source.dims = source.table.at(keys::table::AXES).size();
+      }
+      combined.emplace_back(json_t{
+         { keys::map::NAME, source.name },
+         { keys::map::DIMS, source.dims },
+         { keys::map::TABLE, std::move(source.table) },
+      });
+      manifest[source.key] = source.hash;
+   }
+   save_file(get_path(root, COMBINED), combined);
+   save_file(manifest_path, manifest);
 
-   std::cout << map2.lookup("table2d", 2.0, 0.1) << "\n";
+   std::cout << "converted " << pending.size() << ", unchanged " << (sources.size() - pending.size());
+   std::cout << " (" << sources.size() << " tables)\n";
    return 0;
-}
\ No newline at end of file
+}
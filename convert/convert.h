@@ -69,5 +69,6 @@ namespace convert {
          auto& v = detail::at(table.data, indices);
          v = csv::get<value_t>(row.at(header));
       }
+      table.store(StorageMode::Grid);
    }
 }
\ No newline at end of file
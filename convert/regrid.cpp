@@ -0,0 +1,42 @@
+#include "convert/regrid.h"
+#include <thread>
+
+using namespace convert;
+
+void convert::to_json(lookup::json_t& json, const RegridReport& report) {
+   json = lookup::json_t{
+      { "mode", (report.mode == RegridMode::Uniform) ? "uniform" : "adaptive" },
+      { "tolerance", report.tolerance },
+      { "max_error", report.max_error },
+      { "converged", report.converged },
+      { "iterations", report.iterations },
+      { "sizes_before", report.sizes_before },
+      { "sizes_after", report.sizes_after },
+      { "bytes_before", report.bytes_before },
+      { "bytes_after", report.bytes_after },
+      { "uniform_axes_before", report.uniform_before },
+      { "uniform_axes_after", report.uniform_after },
+      { "lookup_ns_before", report.ns_before },
+      { "lookup_ns_after", report.ns_after },
+      { "speedup", (report.ns_after > 0) ? (report.ns_before / report.ns_after) : 0.0 },
+   };
+}
+
+void convert::parallel_for(size_t count, size_t threads, const std::function<void(size_t, size_t)>& f) {
+   if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1U);
+   }
+   threads = std::max(std::min(threads, count), size_t{ 1 });
+   if (threads == 1) {
+      f(0, count);
+      return;
+   }
+   std::vector<std::thread> workers{};
+   const auto chunk = (count + threads - 1) / threads;
+   for (auto begin = size_t{ 0 }; begin < count; begin += chunk) {
+      workers.emplace_back(f, begin, std::min(begin + chunk, count));
+   }
+   for (auto& worker : workers) {
+      worker.join();
+   }
+}
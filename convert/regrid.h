@@ -0,0 +1,310 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <iterator>
+#include <functional>
+#include "lookup/json.h"
+
+namespace convert {
+
+   enum class RegridMode : int {
+      Uniform,    // evenly spaced breakpoints (directly indexed by lookup)
+      Adaptive    // subset of the source breakpoints, refined where the error is largest
+   };
+
+   struct RegridOptions {
+      RegridMode mode = RegridMode::Uniform;
+      double tolerance = 0;   // maximum interpolation error against the source table
+      size_t threads = 0;     // 0: hardware concurrency
+   };
+
+   struct RegridReport {
+      RegridMode mode = RegridMode::Uniform;
+      double tolerance = 0;
+      double max_error = 0;
+      bool converged = false;
+      size_t iterations = 0;
+      std::vector<size_t> sizes_before{};
+      std::vector<size_t> sizes_after{};
+      size_t bytes_before = 0;
+      size_t bytes_after = 0;
+      size_t uniform_before = 0;   // evenly spaced (directly indexed) axes
+      size_t uniform_after = 0;
+      double ns_before = 0;   // mean lookup time, random queries
+      double ns_after = 0;
+   };
+
+   void to_json(lookup::json_t& json, const RegridReport& report);
+
+   // invokes 'f(begin, end)' on contiguous chunks of [0, count) from 'threads' threads
+   void parallel_for(size_t count, size_t threads, const std::function<void(size_t, size_t)>& f);
+
+   namespace detail {
+      using lookup::int_t;
+      using lookup::int_pack;
+
+      template<size_t N>
+      int_pack<N> unflatten(size_t index, const int_pack<N>& extents) {
+         int_pack<N> indices{};
+         for (auto i = N; i-- > 0;) {
+            indices[i] = static_cast<int_t>(index % static_cast<size_t>(extents[i]));
+            index /= static_cast<size_t>(extents[i]);
+         }
+         return indices;
+      }
+
+      template<class Table, class Point>
+      auto value(const Table& table, const Point& point) {
+         typename Table::axes_bounds_t bounds{};
+         for (auto i = 0U; i < std::size(point); ++i) {
+            lookup::search_axis(bounds[i], table.policies[i], table.axes[i], point[i]);
+         }
+         return table.evaluate(bounds);
+      }
+
+      // largest |target - source| within the axis range. Both tables are multilinear on every
+      // cell of the union of their breakpoints, so is their difference, and its maximum lies on
+      // a union vertex: evaluating all of them gives the exact error
+      template<class Table>
+      auto max_error(const Table& source, const Table& target, size_t threads) {
+         constexpr size_t N = lookup::dimension_v<Table>;
+         using value_t = std::decay_t<lookup::root_t<Table>>;
+         using bounds_t = lookup::bounds<value_t>;
+
+         // brackets of every union coordinate in both tables, searched once per axis
+         lookup::array<std::vector<bounds_t>, N> source_bounds{};
+         lookup::array<std::vector<bounds_t>, N> target_bounds{};
+         int_pack<N> extents{};
+         for (auto i = 0U; i < N; ++i) {
+            std::vector<value_t> coords{};
+            std::merge(std::begin(source.axes[i]), std::end(source.axes[i]),
+               std::begin(target.axes[i]), std::end(target.axes[i]), std::back_inserter(coords));
+            coords.erase(std::unique(std::begin(coords), std::end(coords)), std::end(coords));
+            extents[i] = static_cast<int_t>(std::size(coords));
+            for (const auto& x : coords) {
+               source_bounds[i].emplace_back();
+               target_bounds[i].emplace_back();
+               lookup::search_axis(source_bounds[i].back(), source.policies[i], source.axes[i], x);
+               lookup::search_axis(target_bounds[i].back(), target.policies[i], target.axes[i], x);
+            }
+         }
+
+         const auto count = static_cast<size_t>(lookup::detail::product(extents));
+         auto result = value_t{ 0 };
+         std::mutex mutex{};
+         parallel_for(count, threads, [&](size_t begin, size_t end) {
+            auto error = value_t{ 0 };
+            typename Table::axes_bounds_t a{};
+            typename Table::axes_bounds_t b{};
+            for (auto k = begin; k < end; ++k) {
+               const auto indices = unflatten(k, extents);
+               for (auto i = 0U; i < N; ++i) {
+                  a[i] = source_bounds[i][indices[i]];
+                  b[i] = target_bounds[i][indices[i]];
+               }
+               error = std::max(error, std::abs(target.evaluate(b) - source.evaluate(a)));
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            result = std::max(result, error);
+         });
+         return result;
+      }
+
+      // samples 'source' on 'axes' (same policies), in parallel over the output grid
+      template<class Table>
+      Table resample(const Table& source, const typename Table::axes_t& axes, size_t threads) {
+         constexpr size_t N = lookup::dimension_v<Table>;
+         using value_t = std::decay_t<lookup::root_t<Table>>;
+         Table result{};
+         result.axes = axes;
+         result.policies = source.policies;
+         const auto extents = lookup::sizes(axes);
+         lookup::resize(result.data, extents);
+         parallel_for(static_cast<size_t>(lookup::detail::product(extents)), threads, [&](size_t begin, size_t end) {
+            for (auto k = begin; k < end; ++k) {
+               const auto indices = unflatten(k, extents);
+               lookup::array<value_t, N> point{};
+               for (auto i = 0U; i < N; ++i) {
+                  point[i] = axes[i][indices[i]];
+               }
+               lookup::at(result.data, indices) = value(source, point);
+            }
+         });
+         result.store(lookup::StorageMode::Grid);
+         return result;
+      }
+
+      // worst 1-D error along 'axis' over all source grid lines when each line is resampled on
+      // 'candidate'; entry 2k is source node k, entry 2k+1 the centre of source cell k
+      template<class Table, class Axis>
+      Axis axis_errors(const Table& source, size_t axis, const Axis& candidate, size_t threads) {
+         using value_t = typename Axis::value_type;
+         const auto& xs = source.axes[axis];
+         const auto n = std::size(xs);
+         auto extents = lookup::sizes(source.axes);
+         extents[axis] = 1;
+         const auto lines = static_cast<size_t>(lookup::detail::product(extents));
+
+         std::vector<Axis> partial{};
+         std::mutex mutex{};
+         parallel_for(lines, threads, [&](size_t begin, size_t end) {
+            Axis errors(std::max(2 * n, size_t{ 1 }) - 1, value_t{ 0 });
+            Axis ys(n), samples(std::size(candidate));
+            lookup::bounds<value_t> b{};
+            const lookup::ExtrapolationPolicy policy{};
+            auto interpolate = [&](const Axis& x, const Axis& y, const value_t& at) {
+               lookup::search_axis(b, policy, x, at);
+               return lookup::detail::linear(y[b.lower], y[b.upper], b.slope);
+            };
+            for (auto line = begin; line < end; ++line) {
+               auto indices = unflatten(line, extents);
+               for (auto k = 0U; k < n; ++k) {
+                  indices[axis] = static_cast<int_t>(k);
+                  ys[k] = source.at(indices);
+               }
+               for (auto j = 0U; j < std::size(candidate); ++j) {
+                  samples[j] = interpolate(xs, ys, candidate[j]);
+               }
+               for (auto p = 0U; p < std::size(errors); ++p) {
+                  const auto k = p / 2;
+                  const auto x = (p % 2) ? ((xs[k] + xs[k + 1]) / 2) : xs[k];
+                  const auto exact = (p % 2) ? ((ys[k] + ys[k + 1]) / 2) : ys[k];
+                  errors[p] = std::max(errors[p], std::abs(interpolate(candidate, samples, x) - exact));
+               }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            partial.emplace_back(std::move(errors));
+         });
+
+         Axis errors(std::max(2 * n, size_t{ 1 }) - 1, value_t{ 0 });
+         for (const auto& part : partial) {
+            for (auto p = 0U; p < std::size(errors); ++p) {
+               errors[p] = std::max(errors[p], part[p]);
+            }
+         }
+         return errors;
+      }
+
+      template<class Axis>
+      Axis linspace(const Axis& source, size_t count) {
+         Axis axis(count);
+         for (auto k = 0U; k < count; ++k) {
+            axis[k] = source.front() + ((source.back() - source.front()) * k) / (count - 1);
+         }
+         axis.back() = source.back();
+         return axis;
+      }
+
+      // refines 'axis' until every grid line along it stays within 'budget'; false when the
+      // refinement limit is reached first
+      template<class Table, class Axis>
+      bool refine(const Table& source, size_t index, Axis& axis, double budget, const RegridOptions& options) {
+         const auto& xs = source.axes[index];
+         const auto n = std::size(xs);
+         if (n < 3) {
+            axis = xs;
+            return true;
+         }
+         if (options.mode == RegridMode::Uniform) {
+            // nested doubling (2n - 1 keeps the previous breakpoints), capped at 4x the source
+            auto count = std::max(std::size(axis), size_t{ 2 });
+            const auto cap = 4 * n;
+            for (;;) {
+               axis = linspace(xs, count);
+               const auto errors = axis_errors(source, index, axis, options.threads);
+               if (*std::max_element(std::begin(errors), std::end(errors)) <= budget) return true;
+               if (count >= cap) return false;
+               count = std::min((2 * count) - 1, cap);
+            }
+         }
+
+         // adaptive: insert the source breakpoint nearest to the worst error until within budget
+         if (std::size(axis) < 2) {
+            axis = Axis{ xs.front(), xs.back() };
+         }
+         for (;;) {
+            const auto errors = axis_errors(source, index, axis, options.threads);
+            const auto worst = static_cast<size_t>(std::distance(std::begin(errors),
+               std::max_element(std::begin(errors), std::end(errors))));
+            if (errors[worst] <= budget) return true;
+            auto k = worst / 2;
+            if ((worst % 2) && errors[worst + 1] > errors[worst - 1]) ++k;
+            auto it = std::lower_bound(std::begin(axis), std::end(axis), xs[k]);
+            if (it != std::end(axis) && *it == xs[k]) {
+               // both ends of the worst cell are present: take the other one
+               k = (worst % 2) ? ((k == worst / 2) ? k + 1 : k - 1) : k;
+               it = std::lower_bound(std::begin(axis), std::end(axis), xs[k]);
+               if (it != std::end(axis) && *it == xs[k]) return false;
+            }
+            axis.insert(it, xs[k]);
+         }
+      }
+
+      template<class Table>
+      double lookup_ns(const Table& table, const Table& bounds, size_t count = 200000) {
+         constexpr size_t N = lookup::dimension_v<Table>;
+         using value_t = std::decay_t<lookup::root_t<Table>>;
+         std::mt19937 engine{ 7 };
+         lookup::vector<lookup::array<value_t, N>> queries(count);
+         for (auto i = 0U; i < N; ++i) {
+            std::uniform_real_distribution<value_t> dist(bounds.axes[i].front(), bounds.axes[i].back());
+            for (auto& query : queries) {
+               query[i] = dist(engine);
+            }
+         }
+         lookup::vector<value_t> results{};
+         const auto start = std::chrono::steady_clock::now();
+         table.lookup_batch(queries, results, lookup::BatchMode::Independent);
+         const auto elapsed = std::chrono::steady_clock::now() - start;
+         return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+      }
+   }
+
+   // resamples 'table' onto new axes within 'options.tolerance' (checked exactly, see
+   // 'detail::max_error'). Per-axis refinement budgets start at tolerance / N and are halved until
+   // the full N-D error is within tolerance or no axis can be refined further
+   template<class Table>
+   Table regrid(const Table& table, const RegridOptions& options, RegridReport& report) {
+      constexpr size_t N = lookup::dimension_v<Table>;
+      auto source = table;
+      source.store(lookup::StorageMode::Grid);
+
+      report = RegridReport{};
+      report.mode = options.mode;
+      report.tolerance = options.tolerance;
+      for (const auto& axis : source.axes) {
+         report.sizes_before.emplace_back(std::size(axis));
+      }
+      report.bytes_before = source.footprint();
+
+      typename Table::axes_t axes{};
+      auto budget = options.tolerance / N;
+      Table result{};
+      for (;;) {
+         ++report.iterations;
+         auto limited = false;
+         for (auto i = 0U; i < N; ++i) {
+            limited = !detail::refine(source, i, axes[i], budget, options) || limited;
+         }
+         result = detail::resample(source, axes, options.threads);
+         report.max_error = detail::max_error(source, result, options.threads);
+         report.converged = (report.max_error <= options.tolerance);
+         if (report.converged || limited || report.iterations >= 32) break;
+         budget /= 2;
+      }
+
+      for (const auto& axis : result.axes) {
+         report.sizes_after.emplace_back(std::size(axis));
+      }
+      report.bytes_after = result.footprint();
+      for (auto i = 0U; i < N; ++i) {
+         report.uniform_before += (source.uniform[i] > 0) ? 1 : 0;
+         report.uniform_after += (result.uniform[i] > 0) ? 1 : 0;
+      }
+      report.ns_before = detail::lookup_ns(source, source);
+      report.ns_after = detail::lookup_ns(result, source);
+      return result;
+   }
+}
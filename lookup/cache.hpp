@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstring>
+#include "lookup/lookup.hpp"
+
+namespace lookup {
+
+   struct CachePolicy {
+      size_t capacity = 0;    // slots, rounded up to a power of two (0 disables the cache)
+      std::double_t quantum = 0;   // > 0: inputs are snapped to multiples of 'quantum' first
+   };
+
+   struct cache_stats {
+      size_t hits = 0;
+      size_t misses = 0;
+   };
+
+   namespace detail {
+
+      template<class T>
+      auto hash_bits(const T& value) {
+         std::uint64_t bits = 0;
+         std::memcpy(&bits, &value, std::min(sizeof(T), sizeof(bits)));
+         return bits;
+      }
+
+      template<class T, size_t N>
+      size_t hash(const array<T, N>& key) {
+         std::uint64_t h = 0xcbf29ce484222325ULL;
+         for (const auto& value : key) {
+            h = (h ^ hash_bits(value)) * 0x100000001b3ULL;
+            h ^= (h >> 29);
+         }
+         return static_cast<size_t>(h);
+      }
+   }
+
+   // direct-mapped result cache in front of a single table; one handle per thread
+   // (or subsystem), handles are not safe to share between threads. A handle built from a
+   // replicated table_map keeps the replica of the constructing thread's node, so build it on
+   // the thread that uses it
+   template<size_t N, class T = std::double_t>
+   class cached_table {
+      using table_t = table<N, T>;
+      using key_t = array<T, N>;
+
+      struct entry {
+         key_t key{};
+         T value{};
+         bool valid = false;
+      };
+
+      const table_t* source = nullptr;
+      CachePolicy policy{};
+      vector<entry> slots{};
+      size_t mask = 0;
+      cache_stats counters{};
+
+   public:
+      cached_table() = default;
+
+      cached_table(const table_t& table, CachePolicy policy = {})
+         : source(&table), policy(policy) {
+         if (policy.capacity == 0) return;
+         auto capacity = size_t{ 1 };
+         while (capacity < policy.capacity) capacity <<= 1;
+         slots.resize(capacity);
+         mask = capacity - 1;
+      }
+
+      cached_table(const table_map& map, const std::string& name, CachePolicy policy = {})
+         : cached_table(map.get<N, T>(name), policy) {}
+
+      bool enabled() const {
+         return !slots.empty();
+      }
+
+      const cache_stats& stats() const {
+         return counters;
+      }
+
+      void clear() {
+         for (auto& slot : slots) {
+            slot.valid = false;
+         }
+         counters = cache_stats{};
+      }
+
+      template<class... Values>
+      std::enable_if_t<(N == size_v<Values...>), T>
+         lookup(Values&& ... values) {
+         if (!enabled()) {
+            return source->lookup(std::forward<Values>(values)...);
+         }
+         key_t key{ static_cast<T>(values)... };
+         if (policy.quantum > 0) {
+            // snapped inputs are also what gets evaluated, so results do not depend on call order
+            const auto quantum = static_cast<T>(policy.quantum);
+            for (auto& value : key) {
+               value = std::round(value / quantum) * quantum;
+            }
+         }
+         auto& slot = slots[detail::hash(key) & mask];
+         if (slot.valid && slot.key == key) {
+            ++counters.hits;
+            return slot.value;
+         }
+         ++counters.misses;
+         slot.key = key;
+         slot.value = evaluate(key, std::make_index_sequence<N>{});
+         slot.valid = true;
+         return slot.value;
+      }
+
+   private:
+      template<size_t... I>
+      T evaluate(const key_t& key, std::index_sequence<I...>) const {
+         return source->lookup(key[I]...);
+      }
+   };
+}
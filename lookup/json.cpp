@@ -30,4 +30,15 @@ json_t lookup::load_file(const std::string& path) {
 void lookup::save_file(const std::string& path, const json_t& json) {
    std::ofstream ofs(path);
    ofs << json;
+}
+
+json_t lookup::load_binary(const std::string& path) {
+   std::ifstream ifs(path, std::ios::binary);
+   return json_t::from_cbor(ifs);
+}
+
+void lookup::save_binary(const std::string& path, const json_t& json) {
+   std::ofstream ofs(path, std::ios::binary);
+   const auto bytes = json_t::to_cbor(json);
+   ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
\ No newline at end of file
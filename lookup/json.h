@@ -14,6 +14,10 @@ namespace lookup {
    json_t load_file(const std::string& path);
    void save_file(const std::string& path, const json_t& json);
 
+   // same document model, CBOR encoded
+   json_t load_binary(const std::string& path);
+   void save_binary(const std::string& path, const json_t& json);
+
    namespace keys {
       namespace policy {
          static constexpr auto LOWER = "lower";
@@ -23,6 +27,13 @@ namespace lookup {
          static constexpr auto AXES = "axes";
          static constexpr auto DATA = "data";
          static constexpr auto POLICIES = "policies";
+         static constexpr auto STORAGE = "storage";
+         static constexpr auto TILE = "tile";
+         static constexpr auto ERROR = "error";
+         static constexpr auto OFFSETS = "offsets";
+         static constexpr auto STEPS = "steps";
+         static constexpr auto WIDTHS = "widths";
+         static constexpr auto PAYLOAD = "payload";
       }
       namespace map {
          static constexpr auto TABLE = "table";
@@ -73,8 +84,70 @@ namespace lookup {
       constexpr size_t N = dimension_v<Table>;
       json.at(POLICIES).get_to(table.policies);
       json.at(AXES).get_to(table.axes);
+      auto storage = StorageMode::Grid;
+      if (json.contains(STORAGE)) {
+         const auto mode = json.at(STORAGE).get<int_t>();
+         if (mode < static_cast<int_t>(StorageMode::Grid) || mode > static_cast<int_t>(StorageMode::Compressed)) {
+            throw std::runtime_error("Unknown storage mode " + std::to_string(mode) + ".");
+         }
+         storage = static_cast<StorageMode>(mode);
+      }
+      // tiled tables are serialized in storage order and never expanded into a grid
+      if (storage == StorageMode::Tiled) {
+         table.storage = storage;
+         table.extents = sizes(table.axes);
+         const auto bits = json.at(TILE).get<int_t>();
+         if (bits < 0 || bits > 8) {
+            throw std::runtime_error("Invalid tile size in tiled table.");
+         }
+         table.tiling.reset(table.extents, bits);
+         json.at(DATA).get_to(table.tiles);
+         if (std::size(table.tiles) != static_cast<size_t>(table.tiling.size())) {
+            throw std::runtime_error("Tiled table data does not match its axes.");
+         }
+         table.classify();
+         return;
+      }
+      if (storage == StorageMode::Compressed) {
+         table.storage = storage;
+         table.extents = sizes(table.axes);
+         const auto bits = json.at(TILE).get<int_t>();
+         if (bits < 1 || bits > detail::max_block_bits<N>()) {
+            throw std::runtime_error("Invalid block size in compressed table.");
+         }
+         table.tiling.reset(table.extents, bits);
+         auto& blocks = table.blocks;
+         blocks.shift = table.tiling.bits * static_cast<int_t>(N);
+         json.at(ERROR).get_to(blocks.error);
+         json.at(OFFSETS).get_to(blocks.offsets);
+         json.at(STEPS).get_to(blocks.steps);
+         json.at(WIDTHS).get_to(blocks.widths);
+         // binary in CBOR, {"bytes": [...]} once round-tripped through text JSON
+         const auto& payload = json.at(PAYLOAD);
+         if (payload.is_binary()) {
+            blocks.payload = payload.get_binary();
+         }
+         else {
+            payload.at("bytes").get_to(blocks.payload);
+         }
+         using value_t = std::decay_t<decltype(blocks.error)>;
+         const auto count = static_cast<size_t>(table.tiling.size()) >> blocks.shift;
+         auto valid = std::size(blocks.offsets) == count
+            && std::size(blocks.steps) == count
+            && std::size(blocks.widths) == count;
+         for (const auto width : blocks.widths) {
+            valid = valid && (width == 0 || width == 1 || width == 2 || width == sizeof(value_t));
+         }
+         if (!valid || blocks.index(table.tiling) != std::size(blocks.payload)) {
+            throw std::runtime_error("Compressed table blocks do not match its axes.");
+         }
+         table.classify();
+         return;
+      }
       resize(table.data, sizes(table.axes));
       detail::fill(json[DATA], table.data);
+      // coefficients are derived from 'data', only the selected mode is serialized
+      table.store(storage);
    }
 
    template<class Table>
@@ -84,8 +157,24 @@ namespace lookup {
       json = json_t{
          { POLICIES, table.policies },
          { AXES, table.axes },
-         { DATA, table.data },
+         { STORAGE, static_cast<int_t>(table.storage) },
       };
+      if (table.storage == StorageMode::Tiled) {
+         json[TILE] = table.tiling.bits;
+         json[DATA] = table.tiles;
+      }
+      else if (table.storage == StorageMode::Compressed) {
+         const auto& blocks = table.blocks;
+         json[TILE] = table.tiling.bits;
+         json[ERROR] = blocks.error;
+         json[OFFSETS] = blocks.offsets;
+         json[STEPS] = blocks.steps;
+         json[WIDTHS] = blocks.widths;
+         json[PAYLOAD] = json_t::binary(blocks.payload);
+      }
+      else {
+         json[DATA] = table.data;
+      }
    }
 
    template<class Map>
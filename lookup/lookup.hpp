@@ -1,14 +1,23 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <memory>
+#include <atomic>
 #include <vector>
 #include <array>
 #include <tuple>
 #include <numeric>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 #include <algorithm>
+#include <stdexcept>
 #include <functional>
 #include <type_traits>
+#include "lookup/numa.h"
+#include "lookup/trace.h"
 
 // Check windows
 #if _WIN32 || _WIN64
@@ -154,8 +163,10 @@ namespace lookup {
       using enable_if_nd_t = std::enable_if_t<(dimension_v<Grid> > 1), R>;
 
 
+      // const grids yield const references
       template<class T>
-      using at_t = std::add_lvalue_reference_t<root_t<T>>;
+      using at_t = std::add_lvalue_reference_t<
+         std::conditional_t<std::is_const<T>::value, const root_t<T>, root_t<T>>>;
 
       template<class Grid, size_t N = dimension_v<Grid>>
       enable_if_1d_t<Grid, at_t<Grid>>
@@ -221,45 +232,166 @@ namespace lookup {
       T slope = 0;
    };
 
+   namespace detail {
+
+      // 'upper' is only invoked for values strictly inside the axis range and
+      // must return the std::upper_bound index of 'value'
+      template<class T, template<class> class Alloc, class Upper>
+      void search_axis(bounds<T>& bounds,
+         const ExtrapolationPolicy& policy,
+         const vector<T, Alloc>& axis,
+         const T& value,
+         Upper&& upper) {
+
+         bounds.lower = 0;
+         bounds.upper = 0;
+         bounds.slope = 0;
+
+         if (std::empty(axis)) return;
+
+         if (value >= axis.back()) {
+            bounds.upper = static_cast<int_t>(axis.size() - 1);
+            bounds.lower = bounds.upper;
+            if (policy.upper == ExtrapolationMode::Linear) {
+               --bounds.lower;
+            }
+         }
+         else if (value < axis.front()) {
+            bounds.lower = 0;
+            bounds.upper = bounds.lower;
+            if (policy.lower == ExtrapolationMode::Linear) {
+               ++bounds.upper;
+            }
+         }
+         else if (value > axis.front()) {
+            bounds.upper = upper();
+            bounds.lower = bounds.upper - 1;
+         }
+
+         if (bounds.lower != bounds.upper) {
+            const auto& lower_value = axis[bounds.lower];
+            const auto& upper_value = axis[bounds.upper];
+            bounds.slope = (value - lower_value) / (upper_value - lower_value);
+         }
+         bounds.lower = std::max(bounds.lower, int_t{ 0 });
+         bounds.upper = std::max(bounds.upper, int_t{ 0 });
+      }
+   }
+
    template<class T, template<class> class Alloc>
    auto search_axis(bounds<T>& bounds,
       const ExtrapolationPolicy& policy,
       const vector<T, Alloc>& axis,
       const T& value) {
+      detail::search_axis(bounds, policy, axis, value, [&]() {
+         auto it = std::upper_bound(std::begin(axis), std::end(axis), value);
+         return static_cast<int_t>(std::distance(std::begin(axis), it));
+      });
+   }
+
+   namespace detail {
+
+      // brackets 'value' on an evenly spaced axis ('scale' = 1 / spacing) by direct indexing;
+      // the neighbour checks absorb rounding of the computed index
+      template<class T, template<class> class Alloc>
+      void search_uniform(bounds<T>& bounds,
+         const ExtrapolationPolicy& policy,
+         const vector<T, Alloc>& axis,
+         const T& value,
+         const T& scale) {
+         search_axis(bounds, policy, axis, value, [&]() {
+            const auto last = static_cast<int_t>(std::size(axis)) - 1;
+            auto upper = static_cast<int_t>((value - axis.front()) * scale) + 1;
+            upper = std::min(std::max(upper, int_t{ 1 }), last);
+            while (upper < last && !(value < axis[upper])) ++upper;
+            while (upper > 1 && value < axis[upper - 1]) --upper;
+            return upper;
+         });
+      }
+   }
 
-      bounds.lower = 0;
-      bounds.upper = 0;
-      bounds.slope = 0;
+   enum class BatchMode : int {
+      Independent,   // one search per query and axis
+      Merged         // bucket the axis once, then bracket every query within its bucket
+   };
 
-      if (std::empty(axis)) return;
+   namespace detail {
 
-      if (value >= axis.back()) {
-         bounds.upper = static_cast<int_t>(axis.size() - 1);
-         bounds.lower = bounds.upper;
-         if (policy.upper == ExtrapolationMode::Linear) {
-            --bounds.lower;
+      // how one axis is searched within a merged batch of 'count' queries: evenly spaced axes
+      // ('uniform' = 1 / spacing) are indexed directly; otherwise the axis is cut into uniform
+      // buckets, each holding the upper_bound index of its lower edge, once the batch is at
+      // least as long as the axis (shorter batches would not repay building them)
+      template<class T>
+      struct axis_index {
+         T uniform = 0;
+         T front = 0;
+         T scale = 0;
+         vector<int_t> starts{};
+
+         template<template<class> class Alloc>
+         void build(const vector<T, Alloc>& axis, size_t count, const T& spacing) {
+            uniform = spacing;
+            starts.clear();
+            const auto size = static_cast<int_t>(std::size(axis));
+            const auto range = (size > 1) ? (axis.back() - axis.front()) : T{ 0 };
+            if (uniform > T{ 0 } || !(range > T{ 0 }) || count < static_cast<size_t>(size)) {
+               return;
+            }
+            // a single merge of bucket edges against the axis
+            const auto buckets = static_cast<size_t>(4 * size);
+            front = axis.front();
+            scale = static_cast<T>(buckets) / range;
+            starts.resize(buckets);
+            int_t cursor = 0;
+            for (auto b = 0U; b < buckets; ++b) {
+               const auto edge = front + static_cast<T>(b) / scale;
+               while (cursor < size && !(edge < axis[cursor])) ++cursor;
+               starts[b] = cursor;
+            }
          }
-      }
-      else if (value < axis.front()) {
-         bounds.lower = 0;
-         bounds.upper = bounds.lower;
-         if (policy.lower == ExtrapolationMode::Linear) {
-            ++bounds.upper;
+
+         template<template<class> class Alloc>
+         void search(bounds<T>& bounds,
+            const ExtrapolationPolicy& policy,
+            const vector<T, Alloc>& axis,
+            const T& v) const {
+            if (uniform > T{ 0 }) {
+               search_uniform(bounds, policy, axis, v, uniform);
+               return;
+            }
+            if (std::empty(starts)) {
+               lookup::search_axis(bounds, policy, axis, v);
+               return;
+            }
+            search_axis(bounds, policy, axis, v, [&]() {
+               const auto buckets = std::size(starts);
+               const auto b = std::min(static_cast<size_t>((v - front) * scale), buckets - 1);
+               const auto first = std::begin(axis);
+               auto lo = first + starts[b];
+               auto hi = (b + 1 < buckets) ? (first + starts[b + 1]) : std::end(axis);
+               // bucket edges rounding across 'v' widen the range (clustered axes stay logarithmic)
+               if (lo != first && v < *(lo - 1)) lo = first;
+               if (hi != std::end(axis) && !(v < *hi)) hi = std::end(axis);
+               return static_cast<int_t>(std::distance(first, std::upper_bound(lo, hi, v)));
+            });
          }
-      }
-      else if (value > axis.front()) {
-         auto it = std::upper_bound(std::begin(axis), std::end(axis), value);
-         bounds.upper = static_cast<int_t>(std::distance(std::begin(axis), it));
-         bounds.lower = bounds.upper - 1;
-      }
+      };
+   }
 
-      if (bounds.lower != bounds.upper) {
-         const auto& lower_value = axis[bounds.lower];
-         const auto& upper_value = axis[bounds.upper];
-         bounds.slope = (value - lower_value) / (upper_value - lower_value);
+   // brackets 'count' values against 'axis' in one pass (see 'detail::axis_index');
+   // 'value(k)' returns the k-th coordinate and 'bounds(k)' the bounds it is written to
+   template<class T, template<class> class Alloc, class Value, class Bounds>
+   void search_axis(const ExtrapolationPolicy& policy,
+      const vector<T, Alloc>& axis,
+      size_t count,
+      Value&& value,
+      Bounds&& bounds,
+      const T& uniform = T{ 0 }) {
+      detail::axis_index<T> index{};
+      index.build(axis, count, uniform);
+      for (auto k = 0U; k < count; ++k) {
+         index.search(bounds(k), policy, axis, value(k));
       }
-      bounds.lower = std::max(bounds.lower, int_t{ 0 });
-      bounds.upper = std::max(bounds.upper, int_t{ 0 });
    }
 
    template<class T, size_t N>
@@ -297,6 +429,474 @@ namespace lookup {
       return detail::interpolate(grid, std::begin(bounds));
    }
 
+   enum class StorageMode : int {
+      Grid,       // nested vectors, interpolated through 2^N corner lookups
+      Compiled,   // additionally stores the multilinear coefficients of every cell
+      Tiled,      // replaces the grid by contiguous hypercube tiles (Morton order within a tile)
+      Compressed  // replaces the grid by per-tile quantized blocks, decoded per node on lookup
+   };
+
+   namespace detail {
+
+      // invokes 'f(indices)' for every index pack in [0, extents), last axis fastest
+      template<size_t N, class F>
+      void for_each_index(const int_pack<N>& extents, F&& f) {
+         for (auto i = 0U; i < N; ++i) {
+            if (extents[i] <= 0) return;
+         }
+         int_pack<N> indices{};
+         for (;;) {
+            f(static_cast<const int_pack<N>&>(indices));
+            auto i = N;
+            for (;;) {
+               if (i == 0) return;
+               --i;
+               if (++indices[i] < extents[i]) break;
+               indices[i] = 0;
+            }
+         }
+      }
+
+      template<size_t N>
+      constexpr size_t corners_v = size_t{ 1 } << N;
+
+      template<size_t N>
+      int_t product(const int_pack<N>& extents) {
+         return std::accumulate(std::begin(extents), std::end(extents),
+            int_t{ 1 }, std::multiplies<int_t>{});
+      }
+
+      // coefficient 'mask' of a cell multiplies the product of t[i] over the bits set in 'mask'
+      template<size_t N, class Grid, class Coefficients>
+      void compile(const Grid& grid, const int_pack<N>& sizes, Coefficients& coefficients) {
+         constexpr auto corners = corners_v<N>;
+         coefficients.clear();
+         if (product(sizes) == 0) return;
+
+         // one cell per node: the cells on the upper end of an axis are padding whose
+         // coefficients along that axis vanish, so a bracket's 'lower' is its cell
+         coefficients.resize(corners * static_cast<size_t>(product(sizes)));
+         auto out = std::begin(coefficients);
+         for_each_index(sizes, [&](const int_pack<N>& cell) {
+            for (auto mask = 0U; mask < corners; ++mask) {
+               auto corner = cell;
+               for (auto i = 0U; i < N; ++i) {
+                  if (mask & (1U << i)) {
+                     corner[i] = std::min(corner[i] + 1, sizes[i] - 1);
+                  }
+               }
+               out[mask] = at(grid, corner);
+            }
+            // corner values -> coefficients (Moebius transform over the corner subsets)
+            for (auto i = 0U; i < N; ++i) {
+               for (auto mask = 0U; mask < corners; ++mask) {
+                  if (mask & (1U << i)) {
+                     out[mask] -= out[mask ^ (1U << i)];
+                  }
+               }
+            }
+            out += corners;
+         });
+      }
+
+      // cache-line (64 byte) aligned storage, so no per-cell coefficient block of up to
+      // 64 bytes straddles two lines
+      template<class T>
+      struct aligned_allocator {
+         using value_type = T;
+         static constexpr std::uintptr_t alignment = 64;
+
+         aligned_allocator() = default;
+
+         template<class U>
+         aligned_allocator(const aligned_allocator<U>&) {}
+
+         T* allocate(size_t n) {
+            auto* raw = static_cast<char*>(::operator new((n * sizeof(T)) + alignment + sizeof(void*)));
+            auto address = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+            address = (address + alignment - 1) & ~(alignment - 1);
+            auto* result = reinterpret_cast<char*>(address);
+            std::memcpy(result - sizeof(void*), &raw, sizeof(void*));
+            return reinterpret_cast<T*>(result);
+         }
+
+         void deallocate(T* p, size_t) {
+            void* raw = nullptr;
+            std::memcpy(&raw, reinterpret_cast<char*>(p) - sizeof(void*), sizeof(void*));
+            ::operator delete(raw);
+         }
+
+         template<class U>
+         bool operator==(const aligned_allocator<U>&) const {
+            return true;
+         }
+
+         template<class U>
+         bool operator!=(const aligned_allocator<U>&) const {
+            return false;
+         }
+      };
+
+      template<class T, size_t N, class Coefficients>
+      T evaluate(const Coefficients& coefficients,
+         const int_pack<N>& sizes,
+         const axes_bounds_t<T, N>& bounds) {
+         constexpr auto corners = corners_v<N>;
+         int_t index = 0;
+         for (auto i = 0U; i < N; ++i) {
+            index = (index * sizes[i]) + bounds[i].lower;
+         }
+         // fold the highest axis straight out of the cell block, the rest in place
+         constexpr auto half = corners / 2;
+         const auto* c = coefficients.data() + (index * corners);
+         array<T, half> a{};
+         for (auto mask = 0U; mask < half; ++mask) {
+            a[mask] = c[mask] + (bounds[N - 1].slope * c[mask + half]);
+         }
+         for (auto i = N - 1; i-- > 0;) {
+            const auto width = size_t{ 1 } << i;
+            for (auto mask = 0U; mask < width; ++mask) {
+               a[mask] += bounds[i].slope * a[mask + width];
+            }
+         }
+         return a[0];
+      }
+   }
+
+   namespace detail {
+
+      // maps N-D indices onto tiles of 2^bits nodes per axis; tiles are stored
+      // contiguously in row-major order, the nodes of a tile in Morton (Z) order
+      template<size_t N>
+      struct tiling {
+         int_t bits = 1;
+         int_pack<N> sizes{};
+         int_pack<N> strides{};
+
+         void reset(const int_pack<N>& extents, int_t tile_bits) {
+            bits = tile_bits;
+            sizes = extents;
+            auto stride = int_t{ 1 } << (bits * N);
+            for (auto i = N; i-- > 0;) {
+               strides[i] = stride;
+               stride *= (sizes[i] + (int_t{ 1 } << bits) - 1) >> bits;
+            }
+         }
+
+         int_t size() const {
+            if (product(sizes) == 0) return 0;
+            return strides[0] * ((sizes[0] + (int_t{ 1 } << bits) - 1) >> bits);
+         }
+
+         // default tile extent: 4 nodes per axis (fewer cells straddle tiles) unless that pads
+         // the grid by more than a quarter, then 2
+         static int_t fit(const int_pack<N>& extents) {
+            tiling candidate{};
+            candidate.reset(extents, 2);
+            const auto nodes = product(extents);
+            return (4 * candidate.size() <= 5 * nodes) ? 2 : 1;
+         }
+
+         // storage indices are separable: the sum of one contribution per axis
+         int_t part(size_t axis, int_t index) const {
+            auto result = (index >> bits) * strides[axis];
+            for (auto bit = 0; bit < bits; ++bit) {
+               result |= ((index >> bit) & 1) << ((bit * N) + axis);
+            }
+            return result;
+         }
+
+         int_t index(const int_pack<N>& indices) const {
+            int_t result = 0;
+            for (auto i = 0U; i < N; ++i) {
+               result += part(i, indices[i]);
+            }
+            return result;
+         }
+
+         // inverse of 'index' (may address padding beyond 'sizes')
+         int_pack<N> indices(int_t index) const {
+            const auto shift = bits * static_cast<int_t>(N);
+            auto tile = index >> shift;
+            const auto offset = index & ((int_t{ 1 } << shift) - 1);
+            int_pack<N> result{};
+            for (auto i = 0U; i < N; ++i) {
+               const auto stride = strides[i] >> shift;
+               result[i] = (tile / stride) << bits;
+               tile %= stride;
+               for (auto bit = 0; bit < bits; ++bit) {
+                  result[i] |= ((offset >> ((bit * N) + i)) & 1) << bit;
+               }
+            }
+            return result;
+         }
+      };
+
+      // one block per tile: values decode as 'offset + code * step' from codes of 'width'
+      // bytes (0: constant block, 1 / 2: quantized, sizeof(T): raw values). Tiles cut by the
+      // end of an axis store only their valid nodes; 'ranks' maps their Morton offsets
+      template<class T>
+      struct compressed_blocks {
+         int_t shift = 0;   // log2 of the nodes per tile
+         T error = 0;       // largest decode error over all nodes
+         vector<T> offsets{};
+         vector<T> steps{};
+         vector<unsigned char> widths{};
+         // derived from the tiling (see 'index'): per block the mask of axes its tile is cut
+         // on, per mask the payload position of every Morton offset (empty for full tiles)
+         vector<unsigned char> shapes{};
+         vector<vector<std::uint16_t>> ranks{};
+         vector<size_t> starts{};
+         vector<std::uint8_t> payload{};
+
+         // rebuilds the derived members, returns the payload size the blocks require
+         template<size_t N>
+         size_t index(const tiling<N>& tiling) {
+            const auto nodes = size_t{ 1 } << shift;
+            const auto tile = int_t{ 1 } << tiling.bits;
+            shapes.assign(std::size(widths), 0);
+            ranks.assign(size_t{ 1 } << N, vector<std::uint16_t>{});
+            vector<size_t> counts(size_t{ 1 } << N, nodes);
+            for (auto b = 0U; b < std::size(widths); ++b) {
+               const auto origin = tiling.indices(static_cast<int_t>(b << shift));
+               unsigned char mask = 0;
+               for (auto axis = 0U; axis < N; ++axis) {
+                  if (origin[axis] + tile > tiling.sizes[axis]) mask |= (1 << axis);
+               }
+               shapes[b] = mask;
+               if (mask == 0 || !std::empty(ranks[mask])) continue;
+               auto& rank = ranks[mask];
+               rank.resize(nodes);
+               std::uint16_t count = 0;
+               for (auto i = 0U; i < nodes; ++i) {
+                  const auto local = tiling.indices(static_cast<int_t>(i));
+                  auto valid = true;
+                  for (auto axis = 0U; axis < N; ++axis) {
+                     const auto extent = tiling.sizes[axis] - ((tiling.sizes[axis] - 1) & ~(tile - 1));
+                     valid = valid && (!(mask & (1 << axis)) || local[axis] < extent);
+                  }
+                  rank[i] = count;
+                  if (valid) ++count;
+               }
+               counts[mask] = count;
+            }
+            starts.resize(std::size(widths));
+            size_t start = 0;
+            for (auto b = 0U; b < std::size(widths); ++b) {
+               starts[b] = start;
+               start += widths[b] * counts[shapes[b]];
+            }
+            return start;
+         }
+
+         // payload, rank maps and the per-block offset, step, width, shape and start
+         size_t bytes() const {
+            size_t rank_bytes = 0;
+            for (const auto& rank : ranks) {
+               rank_bytes += std::size(rank) * sizeof(std::uint16_t);
+            }
+            const auto per_block = (2 * sizeof(T)) + (2 * sizeof(unsigned char)) + sizeof(size_t);
+            return std::size(payload) + rank_bytes + (std::size(widths) * per_block);
+         }
+
+         T operator[](int_t index) const {
+            const auto block = static_cast<size_t>(index >> shift);
+            auto i = static_cast<size_t>(index & ((int_t{ 1 } << shift) - 1));
+            const auto width = widths[block];
+            if (width == 0) {
+               return offsets[block];
+            }
+            if (shapes[block] != 0) {
+               i = ranks[shapes[block]][i];
+            }
+            const auto* bytes = payload.data() + starts[block] + (i * width);
+            switch (width) {
+            case 1:
+               return offsets[block] + (steps[block] * bytes[0]);
+            case 2: {
+               std::uint16_t code = 0;
+               std::memcpy(&code, bytes, sizeof(code));
+               return offsets[block] + (steps[block] * code);
+            }
+            default: {
+               T value{};
+               std::memcpy(&value, bytes, sizeof(T));
+               return value;
+            }
+            }
+         }
+      };
+
+      // largest tile extent (bits per axis) whose Morton offsets 'compressed_blocks' can rank
+      template<size_t N>
+      constexpr int_t max_block_bits() {
+         return 16 / static_cast<int_t>(N);
+      }
+
+      // quantizes every tile of 'grid' so no node decodes further than 'max_error' away
+      template<class T, size_t N, class Grid>
+      void compress(const Grid& grid,
+         const tiling<N>& tiling,
+         const T& max_error,
+         compressed_blocks<T>& out) {
+         out = compressed_blocks<T>{};
+         out.shift = tiling.bits * static_cast<int_t>(N);
+         const auto values_per_block = size_t{ 1 } << out.shift;
+         const auto count = static_cast<size_t>(tiling.size()) >> out.shift;
+         const auto step = 2 * max_error;
+
+         vector<T> values(values_per_block);
+         vector<bool> valid(values_per_block);
+         for (auto b = 0U; b < count; ++b) {
+            auto lo = std::numeric_limits<T>::max();
+            auto hi = std::numeric_limits<T>::lowest();
+            for (auto i = 0U; i < values_per_block; ++i) {
+               const auto indices = tiling.indices(static_cast<int_t>((b << out.shift) + i));
+               valid[i] = true;
+               for (auto axis = 0U; axis < N; ++axis) {
+                  valid[i] = valid[i] && (indices[axis] < tiling.sizes[axis]);
+               }
+               if (!valid[i]) continue;
+               values[i] = at(grid, indices);
+               lo = std::min(lo, values[i]);
+               hi = std::max(hi, values[i]);
+            }
+            if (hi < lo) {
+               lo = hi = T{ 0 };
+            }
+
+            unsigned char width = sizeof(T);
+            auto offset = lo;
+            auto levels = T{ 0 };
+            if ((hi - lo) <= step) {
+               width = 0;
+               offset = lo + ((hi - lo) / 2);
+            }
+            else if (max_error > 0) {
+               levels = std::ceil((hi - lo) / step);
+               if (levels < 256) width = 1;
+               else if (levels < 65536) width = 2;
+            }
+            out.offsets.emplace_back(offset);
+            out.steps.emplace_back((width == 1 || width == 2) ? step : T{ 0 });
+            out.widths.emplace_back(width);
+
+            // padding (beyond the axes) is never stored, see 'compressed_blocks::index'
+            for (auto i = 0U; i < values_per_block; ++i) {
+               if (!valid[i]) continue;
+               const auto value = values[i];
+               auto decoded = value;
+               if (width == 0) {
+                  decoded = offset;
+               }
+               else if (width == sizeof(T)) {
+                  std::uint8_t bytes[sizeof(T)];
+                  std::memcpy(bytes, &value, sizeof(T));
+                  out.payload.insert(std::end(out.payload), bytes, bytes + sizeof(T));
+               }
+               else {
+                  const auto code = std::min(std::round((value - lo) / step), levels);
+                  decoded = lo + (step * code);
+                  if (width == 1) {
+                     out.payload.emplace_back(static_cast<std::uint8_t>(code));
+                  }
+                  else {
+                     const auto word = static_cast<std::uint16_t>(code);
+                     std::uint8_t bytes[sizeof(word)];
+                     std::memcpy(bytes, &word, sizeof(word));
+                     out.payload.insert(std::end(out.payload), bytes, bytes + sizeof(word));
+                  }
+               }
+               out.error = std::max(out.error, std::abs(decoded - value));
+            }
+         }
+         out.payload.shrink_to_fit();
+         out.index(tiling);
+      }
+
+      // storage offsets of the lower / upper bracket node of every axis
+      template<size_t N>
+      using tile_parts_t = array<array<int_t, 2>, N>;
+
+      template<size_t I, class T, size_t N, class Values>
+      std::enable_if_t<(I + 1 == N), T>
+         interpolate(const Values& values,
+            const tile_parts_t<N>& parts,
+            const axes_bounds_t<T, N>& bounds,
+            int_t offset) {
+         return linear(values[offset + parts[I][0]],
+            values[offset + parts[I][1]],
+            bounds[I].slope);
+      }
+
+      template<size_t I, class T, size_t N, class Values>
+      std::enable_if_t<(I + 1 < N), T>
+         interpolate(const Values& values,
+            const tile_parts_t<N>& parts,
+            const axes_bounds_t<T, N>& bounds,
+            int_t offset) {
+         return linear(interpolate<I + 1>(values, parts, bounds, offset + parts[I][0]),
+            interpolate<I + 1>(values, parts, bounds, offset + parts[I][1]),
+            bounds[I].slope);
+      }
+
+      template<class T, size_t N, class Values>
+      T interpolate(const Values& values,
+         const tiling<N>& tiling,
+         const axes_bounds_t<T, N>& bounds) {
+         tile_parts_t<N> parts{};
+         for (auto i = 0U; i < N; ++i) {
+            parts[i][0] = tiling.part(i, bounds[i].lower);
+            parts[i][1] = tiling.part(i, bounds[i].upper);
+         }
+         return interpolate<0>(values, parts, bounds, int_t{ 0 });
+      }
+   }
+
+   template<class T>
+   struct inverse_result {
+      vector<T> solutions{};   // ascending axis coordinates
+      bool monotonic = false;  // solved through the monotonic (bisection) path
+   };
+
+   namespace detail {
+
+      // direction flags of a 1-D curve / grid line
+      enum : unsigned char {
+         RISES = 1,
+         FALLS = 2
+      };
+
+      template<class T>
+      void add_solution(vector<T>& solutions, const T& x) {
+         if (std::empty(solutions) || solutions.back() != x) {
+            solutions.emplace_back(x);
+         }
+      }
+
+      // solves y(x) == target on the segment (x0, y0) - (x1, y1); 'lower' / 'upper'
+      // extend the segment beyond its start / end (linear extrapolation)
+      template<class T>
+      void solve(vector<T>& solutions,
+         const T& x0, const T& y0,
+         const T& x1, const T& y1,
+         const T& target,
+         bool lower = false,
+         bool upper = false) {
+         if (y0 == y1) {
+            if (y0 == target) {
+               add_solution(solutions, x0);
+               add_solution(solutions, x1);
+            }
+            return;
+         }
+         const auto slope = (target - y0) / (y1 - y0);
+         if ((slope >= 0 || lower) && (slope <= 1 || upper)) {
+            add_solution(solutions, x0 + (slope * (x1 - x0)));
+         }
+      }
+   }
+
    namespace detail {
 
       template<class Map, class Key>
@@ -306,6 +906,7 @@ namespace lookup {
 
       struct table_base {
          virtual ~table_base() = default;
+         virtual std::unique_ptr<table_base> clone() const = 0;
       };
 
       template<class Table>
@@ -318,6 +919,10 @@ namespace lookup {
    struct table : detail::table_base {
       virtual ~table() = default;
 
+      std::unique_ptr<detail::table_base> clone() const override {
+         return std::make_unique<table>(*this);
+      }
+
       using int_pack = int_pack<N>;
       using data_t = grid_t<T, N, Alloc>;
       using axes_t = axes_t<T, N, Alloc>;
@@ -329,19 +934,373 @@ namespace lookup {
       axes_t axes{};
       data_t data{};
       axes_policies_t policies{};
+      StorageMode storage = StorageMode::Grid;
+      vector<T, detail::aligned_allocator> coefficients{};
+      vector<T, Alloc> tiles{};
+      detail::tiling<N> tiling{};
+      detail::compressed_blocks<T> blocks{};
+      // decode error already folded into 'data' (a grid materialized from Compressed storage);
+      // added to the error of any later compression
+      T loss = 0;
+      int_pack extents{};
+      // per axis, the RISES / FALLS flags of every grid line along it (see 'classify')
+      array<vector<unsigned char>, N> directions{};
+      // per axis, 1 / spacing of uniformly spaced axes (0: searched by bisection)
+      array<T, N> uniform{};
+
+      // (re)builds the representation used by 'evaluate'; call again after editing 'data'.
+      // 'tile_bits' sets the tile / block extent (2^tile_bits nodes per axis) of the Tiled
+      // and Compressed modes (0: chosen from the axis sizes), 'max_error' the largest decode
+      // error of Compressed
+      void store(StorageMode mode, int_t tile_bits = 0, T max_error = 0) {
+         if (storage == StorageMode::Tiled || storage == StorageMode::Compressed) {
+            data_t grid{};
+            resize(grid, sizes(axes));
+            for_each([&](const int_pack& indices, const T& value) {
+               detail::at(grid, indices) = value;
+            });
+            data = std::move(grid);
+            loss = error();
+         }
+
+         storage = mode;
+         extents = sizes(axes);
+         coefficients.clear();
+         tiles.clear();
+         blocks = detail::compressed_blocks<T>{};
+         if (mode == StorageMode::Compiled) {
+            detail::compile(data, extents, coefficients);
+         }
+         else if (mode == StorageMode::Compressed) {
+            pack(tile_bits, max_error, false);
+         }
+         else if (mode == StorageMode::Tiled) {
+            tiling.reset(extents, (tile_bits > 0) ? tile_bits : detail::tiling<N>::fit(extents));
+            tiles.resize(static_cast<size_t>(tiling.size()));
+            detail::for_each_index(extents, [&](const int_pack& indices) {
+               tiles[tiling.index(indices)] = detail::at(data, indices);
+            });
+            data = data_t{};
+         }
+         coefficients.shrink_to_fit();
+         tiles.shrink_to_fit();
+         classify();
+      }
+
+      // block-compressed storage, 'error()' reports the decode error actually reached.
+      // 'block_bits' = 0 picks the block extent with the smallest footprint; when even that
+      // outgrows the grid, the table stays a grid and false is returned
+      bool compress(T max_error, int_t block_bits = 0) {
+         if (storage != StorageMode::Grid) {
+            store(StorageMode::Grid);
+         }
+         if (!pack(block_bits, max_error, true)) {
+            return false;
+         }
+         classify();
+         return true;
+      }
+
+      // largest decode error against the values the table was built from (an upper bound
+      // once lossy storage has been round-tripped through a grid)
+      T error() const {
+         return (storage == StorageMode::Compressed) ? blocks.error : loss;
+      }
+
+      // bytes held by the active representation and the lookup metadata (excluding axes)
+      size_t footprint() const {
+         size_t result = 0;
+         for (const auto& flags : directions) {
+            result += std::size(flags);
+         }
+         switch (storage) {
+         case StorageMode::Compiled:
+            return result + ((std::size(coefficients) + static_cast<size_t>(detail::product(extents))) * sizeof(T));
+         case StorageMode::Tiled:
+            return result + (std::size(tiles) * sizeof(T));
+         case StorageMode::Compressed:
+            return result + blocks.bytes();
+         default:
+            return result + (static_cast<size_t>(detail::product(sizes(axes))) * sizeof(T));
+         }
+      }
+
+      // records the axes that can be indexed directly (uniform spacing) and the direction of
+      // every grid line so 'inverse' can bisect monotonic slices
+      void classify() {
+         const auto counts = sizes(axes);
+         for (auto axis = 0U; axis < N; ++axis) {
+            const auto& values = axes[axis];
+            uniform[axis] = T{ 0 };
+            if (counts[axis] < 2) continue;
+            const auto range = values.back() - values.front();
+            const auto step = range / static_cast<T>(counts[axis] - 1);
+            auto regular = (step > 0);
+            for (auto k = 0U; regular && k < std::size(values); ++k) {
+               const auto expected = values.front() + (step * static_cast<T>(k));
+               regular = (std::abs(values[k] - expected) <= (range * T{ 1e-9 }));
+            }
+            if (regular) {
+               uniform[axis] = T{ 1 } / step;
+            }
+         }
+         for (auto axis = 0U; axis < N; ++axis) {
+            auto& flags = directions[axis];
+            flags.assign(static_cast<size_t>(detail::product(counts) / std::max(counts[axis], int_t{ 1 })), 0);
+            for_each([&](const int_pack& indices, const T& value) {
+               if (indices[axis] + 1 >= counts[axis]) return;
+               auto next = indices;
+               ++next[axis];
+               const auto delta = at(next) - value;
+               auto& flag = flags[line(axis, indices)];
+               if (delta > 0) flag |= detail::RISES;
+               if (delta < 0) flag |= detail::FALLS;
+            });
+         }
+      }
+
+      T evaluate(const axes_bounds_t& bounds) const {
+         if (storage == StorageMode::Compiled) {
+            return detail::evaluate(coefficients, extents, bounds);
+         }
+         if (storage == StorageMode::Tiled) {
+            return detail::interpolate(tiles, tiling, bounds);
+         }
+         if (storage == StorageMode::Compressed) {
+            return detail::interpolate(blocks, tiling, bounds);
+         }
+         return interpolate(data, bounds);
+      }
+
+      // node value regardless of the storage mode
+      T at(const int_pack& indices) const {
+         if (storage == StorageMode::Tiled) {
+            return tiles[tiling.index(indices)];
+         }
+         if (storage == StorageMode::Compressed) {
+            return blocks[tiling.index(indices)];
+         }
+         return detail::at(data, indices);
+      }
+
+      // invokes 'f(indices, value)' for every node, last axis fastest
+      template<class F>
+      void for_each(F&& f) const {
+         detail::for_each_index(sizes(axes), [&](const int_pack& indices) {
+            f(indices, at(indices));
+         });
+      }
 
       template<class... Values>
       std::enable_if_t<(N == size_v<Values...>), T>
          lookup(Values&& ... values) const {
-         const targets_t targets{ static_cast<T&&>(values)... };
+         const targets_t targets{ static_cast<T>(values)... };
+         axes_bounds_t bounds{};
          for (auto i = 0U; i < N; ++i) {
-            search_axis(bounds[i], policies[i], axes[i], targets[i]);
+            search(i, bounds[i], targets[i]);
+         }
+         return evaluate(bounds);
+      }
+
+      // solves lookup(...) == target for the coordinate on 'axis', the other axes fixed at
+      // 'others' (in axis order). All crossings of the 1-D curve are returned; slices known to
+      // be monotonic (see 'classify') are bisected instead of scanned. A run of nodes equal to
+      // 'target' reports its first and last coordinate
+      template<class... Values>
+      std::enable_if_t<(N == size_v<Values...> + 1), inverse_result<T>>
+         inverse(size_t axis, const T& target, Values&& ... others) const {
+         if (axis >= N) {
+            throw std::out_of_range("Axis " + std::to_string(axis) + " out of range for a " + std::to_string(N) + "-D table.");
+         }
+         const array<T, N - 1> coords{ static_cast<T>(others)... };
+         axes_bounds_t bounds{};
+         for (auto i = 0U, j = 0U; i < N; ++i) {
+            if (i == axis) continue;
+            search(i, bounds[i], coords[j++]);
+         }
+
+         const auto& xs = axes[axis];
+         const auto count = static_cast<int_t>(std::size(xs));
+         auto curve = [&](int_t k) {
+            auto local = bounds;
+            local[axis] = bounds_t{ k, k, T{ 0 } };
+            return evaluate(local);
+         };
+
+         inverse_result<T> result{};
+         if (count == 0) return result;
+         if (count == 1) {
+            if (curve(0) == target) result.solutions.emplace_back(xs[0]);
+            return result;
+         }
+
+         const auto& policy = policies[axis];
+         const auto lower = (policy.lower == ExtrapolationMode::Linear);
+         const auto upper = (policy.upper == ExtrapolationMode::Linear);
+         const auto direction = slice_direction(axis, bounds);
+         if (direction == detail::RISES || direction == detail::FALLS) {
+            // f(k) = sign * (y_k - target) is non-decreasing along the axis
+            const auto sign = (direction == detail::RISES) ? T{ 1 } : T{ -1 };
+            auto f = [&](int_t k) {
+               return sign * (curve(k) - target);
+            };
+            // smallest k in [lo, hi) not satisfying 'before' (hi when every k does)
+            auto bisect = [](int_t lo, int_t hi, auto&& before) {
+               while (lo < hi) {
+                  const auto mid = lo + ((hi - lo) / 2);
+                  if (before(mid)) lo = mid + 1;
+                  else hi = mid;
+               }
+               return lo;
+            };
+            const auto last = count - 1;
+            result.monotonic = true;
+            if (f(0) > 0) {
+               if (lower) detail::solve(result.solutions, xs[0], curve(0), xs[1], curve(1), target, true, false);
+               return result;
+            }
+            if (f(last) < 0) {
+               if (upper) detail::solve(result.solutions, xs[last - 1], curve(last - 1), xs[last], curve(last), target, false, true);
+               return result;
+            }
+            const auto first = bisect(0, last, [&](int_t k) { return f(k) < 0; });
+            const auto y_first = curve(first);
+            if (y_first != target) {
+               detail::solve(result.solutions, xs[first - 1], curve(first - 1), xs[first], y_first, target);
+               return result;
+            }
+            const auto end = bisect(first, count, [&](int_t k) { return f(k) <= 0; });
+            detail::add_solution(result.solutions, xs[first]);
+            detail::add_solution(result.solutions, xs[end - 1]);
+            return result;
+         }
+
+         vector<T> ys(static_cast<size_t>(count));
+         for (int_t k = 0; k < count; ++k) {
+            ys[k] = curve(k);
+         }
+         for (int_t k = 0; k + 1 < count; ++k) {
+            if (ys[k] == target && ys[k + 1] == target) {
+               auto end = k + 1;
+               while (end + 1 < count && ys[end + 1] == target) ++end;
+               detail::add_solution(result.solutions, xs[k]);
+               detail::add_solution(result.solutions, xs[end]);
+               k = end - 1;
+               continue;
+            }
+            detail::solve(result.solutions, xs[k], ys[k], xs[k + 1], ys[k + 1], target,
+               lower && (k == 0), upper && (k + 2 == count));
+         }
+         std::sort(std::begin(result.solutions), std::end(result.solutions));
+         return result;
+      }
+
+      // evaluates every query (one N-D point each) into 'results', in query order
+      void lookup_batch(const vector<targets_t>& queries,
+         vector<T>& results,
+         BatchMode mode = BatchMode::Merged) const {
+         const auto count = std::size(queries);
+         results.resize(count);
+         if (mode == BatchMode::Independent) {
+            axes_bounds_t local{};
+            for (auto k = 0U; k < count; ++k) {
+               for (auto i = 0U; i < N; ++i) {
+                  search(i, local[i], queries[k][i]);
+               }
+               results[k] = evaluate(local);
+            }
+            return;
+         }
+
+         array<detail::axis_index<T>, N> indices{};
+         for (auto i = 0U; i < N; ++i) {
+            indices[i].build(axes[i], count, uniform[i]);
+         }
+         axes_bounds_t local{};
+         for (auto k = 0U; k < count; ++k) {
+            for (auto i = 0U; i < N; ++i) {
+               indices[i].search(local[i], policies[i], axes[i], queries[k][i]);
+            }
+            results[k] = evaluate(local);
          }
-         return interpolate(data, bounds);
       }
 
    private:
-      mutable axes_bounds_t bounds{};
+      // compresses the grid in 'data' with 'tile_bits' or, when 0, the block extent giving the
+      // smallest payload. With 'smaller', a payload larger than the grid leaves the table
+      // untouched (false); the grid is only dropped once the blocks replace it
+      bool pack(int_t tile_bits, T max_error, bool smaller) {
+         const auto counts = sizes(axes);
+         const auto last = std::min(int_t{ 3 }, detail::max_block_bits<N>());
+         const auto first = (tile_bits > 0) ? std::min(tile_bits, detail::max_block_bits<N>()) : int_t{ 1 };
+         detail::tiling<N> best_tiling{};
+         detail::compressed_blocks<T> best{};
+         for (auto bits = first; bits <= ((tile_bits > 0) ? first : last); ++bits) {
+            detail::tiling<N> candidate{};
+            candidate.reset(counts, bits);
+            detail::compressed_blocks<T> compressed{};
+            detail::compress(data, candidate, max_error, compressed);
+            if (bits == first || compressed.bytes() < best.bytes()) {
+               best_tiling = candidate;
+               best = std::move(compressed);
+            }
+         }
+         if (smaller && best.bytes() > static_cast<size_t>(detail::product(counts)) * sizeof(T)) {
+            return false;
+         }
+         best.error += loss;
+         loss = T{ 0 };
+         storage = StorageMode::Compressed;
+         extents = counts;
+         coefficients.clear();
+         tiles.clear();
+         tiling = best_tiling;
+         blocks = std::move(best);
+         data = data_t{};
+         return true;
+      }
+
+      // uniform axes are indexed directly (corrected by one step against rounding)
+      void search(size_t i, bounds_t& bounds, const T& value) const {
+         if (uniform[i] > 0) {
+            detail::search_uniform(bounds, policies[i], axes[i], value, uniform[i]);
+         }
+         else {
+            search_axis(bounds, policies[i], axes[i], value);
+         }
+      }
+
+      // index of the grid line along 'axis' through 'indices'
+      size_t line(size_t axis, const int_pack& indices) const {
+         size_t index = 0;
+         for (auto i = 0U; i < N; ++i) {
+            if (i == axis) continue;
+            index = (index * std::size(axes[i])) + static_cast<size_t>(indices[i]);
+         }
+         return index;
+      }
+
+      // combined direction flags of the grid lines spanning the bracket of the other axes;
+      // unknown (0) when not classified or when another axis is extrapolated
+      unsigned char slice_direction(size_t axis, const axes_bounds_t& bounds) const {
+         const auto& flags = directions[axis];
+         if (std::empty(flags)) return 0;
+         for (auto i = 0U; i < N; ++i) {
+            if (i == axis) continue;
+            if (bounds[i].slope < 0 || bounds[i].slope > 1) return 0;
+         }
+         unsigned char direction = 0;
+         for (auto mask = 0U; mask < detail::corners_v<N>; ++mask) {
+            if (mask & (1U << axis)) continue;
+            int_pack corner{};
+            for (auto i = 0U; i < N; ++i) {
+               if (i == axis) continue;
+               corner[i] = (mask & (1U << i)) ? bounds[i].upper : bounds[i].lower;
+            }
+            direction |= flags[line(axis, corner)];
+         }
+         return direction;
+      }
    };
 
    class table_map {
@@ -349,14 +1308,34 @@ namespace lookup {
       using dim_map_t = std::map<std::string, table_ptr_t>;
       using multi_map_t = std::map<size_t, dim_map_t>;
       multi_map_t maps{};
+      // copies of 'maps' for NUMA nodes 1..n-1 ('maps' itself serves node 0)
+      vector<multi_map_t> replicas{};
+      std::atomic<trace_writer*> tracer{ nullptr };
+
+      const multi_map_t& local() const {
+         if (replicas.empty()) return maps;
+         const auto node = numa::current_node() % (replicas.size() + 1);
+         return (node == 0) ? maps : replicas[node - 1];
+      }
+
+      static multi_map_t clone(const multi_map_t& source) {
+         multi_map_t copy{};
+         for (const auto& dim_map : source) {
+            auto& target = copy[dim_map.first];
+            for (const auto& pair : dim_map.second) {
+               target.emplace(pair.first, pair.second->clone());
+            }
+         }
+         return copy;
+      }
 
       bool contains(size_t N) const {
-         return detail::contains(maps, N);
+         return detail::contains(local(), N);
       }
 
       bool contains(size_t N, const std::string& name) const {
          if (!contains(N)) return false;
-         return detail::contains(maps.at(N), name);
+         return detail::contains(local().at(N), name);
       }
 
       template<size_t N, class Table = table<N>>
@@ -377,14 +1356,24 @@ namespace lookup {
             throw std::runtime_error(msg);
          }
 #endif
-         const auto& base = maps.at(N).at(name);
+         const auto& base = local().at(N).at(name);
          return static_cast<const Table&>(*base);
       }
 
    public:
       table_map() = default;
-      table_map(table_map&&) = default;
-      table_map& operator=(table_map&&) = default;
+
+      table_map(table_map&& other)
+         : maps(std::move(other.maps)),
+         replicas(std::move(other.replicas)),
+         tracer(other.tracer.load()) {}
+
+      table_map& operator=(table_map&& other) {
+         maps = std::move(other.maps);
+         replicas = std::move(other.replicas);
+         tracer = other.tracer.load();
+         return *this;
+      }
 
       table_map(const table_map&) = delete;
       table_map& operator=(const table_map&) = delete;
@@ -393,9 +1382,36 @@ namespace lookup {
          return this->maps;
       }
 
+      template<size_t N, class T = std::double_t>
+      const table<N, T>& get(const std::string& name) const {
+         return get_table<N, table<N, T>>(name);
+      }
+
+      // copies every table onto NUMA nodes 1..n-1 (first touch from a thread bound to the
+      // node); node 0 keeps the loaded tables. Lookups through the map then read the copy
+      // local to the calling thread. References from 'get' (and the cached_table / lookup_plan
+      // handles built on them) resolve once, on the calling thread's node: references into
+      // node 0 stay valid across 'replicate', references into replicas do not. Call once all
+      // tables are loaded: 'emplace' drops existing replicas
+      void replicate(NumaPolicy policy = {}) {
+         const auto nodes = std::max((policy.nodes > 0) ? policy.nodes : numa::node_count(), size_t{ 1 });
+         replicas.clear();
+         replicas.resize(nodes - 1);
+         for (auto node = size_t{ 1 }; node < nodes; ++node) {
+            numa::run_on_node(node, [&]() {
+               replicas[node - 1] = clone(maps);
+            });
+         }
+      }
+
+      size_t replica_count() const {
+         return replicas.size() + 1;
+      }
+
       template<class Table, size_t N = dimension_v<Table>>
       void emplace(const std::string & name, Table && table) {
-         if (!contains(N)) {
+         replicas.clear();
+         if (!detail::contains(maps, N)) {
             maps.emplace(N, dim_map_t{});
          }
          maps.at(N)[name] = table_ptr_t{
@@ -403,11 +1419,31 @@ namespace lookup {
          };
       }
 
+      // records every subsequent 'lookup' (name and inputs) into 'writer'; nullptr stops.
+      // Safe to call while other threads look up, but the map does not own the writer: detach
+      // it (trace(nullptr)) and let in-flight lookups finish before destroying it
+      void trace(trace_writer* writer) {
+         tracer.store(writer, std::memory_order_release);
+      }
+
       template<class... Values>
       auto lookup(const std::string& name, Values&& ... values) const {
          constexpr size_t N = size_v<Values...>;
+         if (auto* writer = tracer.load(std::memory_order_acquire)) {
+            const array<std::double_t, N> inputs{ static_cast<std::double_t>(values)... };
+            writer->record(name, inputs.data(), N);
+         }
          const auto& table = get_table<N>(name);
          return table.lookup(std::forward<Values>(values)...);
       }
+
+      template<class T, size_t N>
+      void lookup_batch(const std::string& name,
+         const vector<array<T, N>>& queries,
+         vector<T>& results,
+         BatchMode mode = BatchMode::Merged) const {
+         const auto& table = get_table<N, lookup::table<N, T>>(name);
+         table.lookup_batch(queries, results, mode);
+      }
    };
 }
\ No newline at end of file
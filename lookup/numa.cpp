@@ -0,0 +1,122 @@
+#include "lookup/numa.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace lookup;
+
+namespace {
+
+   using cpus_t = std::vector<int>;
+   constexpr auto NO_NODE = static_cast<std::size_t>(-1);
+   thread_local std::size_t simulated = NO_NODE;
+
+   // sysfs cpulist syntax, e.g. "0-3,8-11"
+   cpus_t parse_cpulist(const std::string& text) {
+      cpus_t cpus{};
+      std::istringstream is(text);
+      std::string range{};
+      while (std::getline(is, range, ',')) {
+         if (range.empty()) continue;
+         const auto dash = range.find('-');
+         const auto first = std::stoi(range.substr(0, dash));
+         const auto last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+         for (auto cpu = first; cpu <= last; ++cpu) {
+            cpus.emplace_back(cpu);
+         }
+      }
+      return cpus;
+   }
+
+   const std::vector<cpus_t>& topology() {
+      static const auto nodes = [] {
+         std::vector<cpus_t> nodes{};
+#if defined(__linux__)
+         for (;;) {
+            const auto path = "/sys/devices/system/node/node" + std::to_string(nodes.size()) + "/cpulist";
+            std::ifstream ifs(path);
+            std::string line{};
+            if (!ifs || !std::getline(ifs, line)) break;
+            nodes.emplace_back(parse_cpulist(line));
+         }
+#endif
+         return nodes;
+      }();
+      return nodes;
+   }
+
+   std::size_t query_node() {
+#if defined(__linux__)
+      static const auto cpu_nodes = [] {
+         std::vector<std::size_t> cpu_nodes{};
+         const auto& nodes = topology();
+         for (auto node = 0U; node < nodes.size(); ++node) {
+            for (const auto cpu : nodes[node]) {
+               if (static_cast<std::size_t>(cpu) >= cpu_nodes.size()) {
+                  cpu_nodes.resize(cpu + 1, 0);
+               }
+               cpu_nodes[cpu] = node;
+            }
+         }
+         return cpu_nodes;
+      }();
+      const auto cpu = sched_getcpu();
+      if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_nodes.size()) {
+         return cpu_nodes[cpu];
+      }
+#endif
+      return 0;
+   }
+
+   void bind(std::size_t node) {
+#if defined(__linux__)
+      const auto& nodes = topology();
+      if (node >= nodes.size() || nodes[node].empty()) return;
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (const auto cpu : nodes[node]) {
+         CPU_SET(cpu, &set);
+      }
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+   }
+}
+
+std::size_t numa::node_count() {
+   return std::max(topology().size(), std::size_t{ 1 });
+}
+
+std::size_t numa::current_node() {
+   if (simulated != NO_NODE) return simulated;
+   // threads rarely migrate between nodes, re-query only every so often
+   thread_local std::size_t node = 0;
+   thread_local unsigned countdown = 0;
+   if (countdown-- == 0) {
+      countdown = 1023;
+      node = query_node();
+   }
+   return node;
+}
+
+void numa::set_thread_node(std::size_t node) {
+   simulated = node;
+}
+
+void numa::clear_thread_node() {
+   simulated = NO_NODE;
+}
+
+void numa::run_on_node(std::size_t node, const std::function<void()>& f) {
+   std::thread thread([&]() {
+      bind(node);
+      f();
+   });
+   thread.join();
+}
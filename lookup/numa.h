@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace lookup {
+
+   struct NumaPolicy {
+      std::size_t nodes = 0;   // replica count; 0 uses the nodes reported by the OS
+   };
+
+   namespace numa {
+
+      // NUMA nodes reported by the OS (1 when unknown / unsupported)
+      std::size_t node_count();
+
+      // node of the calling thread; a simulated node set through 'set_thread_node' wins
+      std::size_t current_node();
+
+      // simulates the calling thread running on 'node' (testing on single-node machines)
+      void set_thread_node(std::size_t node);
+      void clear_thread_node();
+
+      // runs 'f' on a thread bound to the cpus of 'node' so memory it first touches is
+      // placed on that node; runs unbound when 'node' does not exist
+      void run_on_node(std::size_t node, const std::function<void()>& f);
+   }
+}
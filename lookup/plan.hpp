@@ -0,0 +1,172 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include "lookup/lookup.hpp"
+
+namespace lookup {
+
+   // one table lookup of a plan: 'inputs[i]' is the state variable fed to axis i
+   struct binding {
+      std::string table{};
+      vector<size_t> inputs{};
+   };
+
+   // a fixed list of table lookups over a shared state vector. Axis searches are
+   // de-duplicated across tables (same breakpoints, policy and input variable), run
+   // once per state, and the interpolations follow back to back. The plan refers to
+   // the tables of the map it was compiled from and must not outlive them; with a
+   // replicated map these are the replica of the compiling thread's node
+   template<class T = std::double_t>
+   class lookup_plan {
+      using bounds_t = bounds<T>;
+      using evaluate_t = T(*)(const detail::table_base&, const bounds_t*, const size_t*);
+
+      struct search {
+         const vector<T>* axis = nullptr;
+         ExtrapolationPolicy policy{};
+         size_t input = 0;
+         T uniform = 0;   // 1 / spacing of evenly spaced axes (see table::classify)
+
+         void run(bounds_t& bounds, const T& value) const {
+            if (uniform > 0) {
+               detail::search_uniform(bounds, policy, *axis, value, uniform);
+            }
+            else {
+               search_axis(bounds, policy, *axis, value);
+            }
+         }
+      };
+
+      struct entry {
+         const detail::table_base* table = nullptr;
+         evaluate_t evaluate = nullptr;
+         vector<size_t> searches{};
+      };
+
+      vector<search> searches{};
+      vector<entry> entries{};
+
+      template<size_t N>
+      static T evaluate_entry(const detail::table_base& base,
+         const bounds_t* searched,
+         const size_t* indices) {
+         const auto& table = detail::table_cast<lookup::table<N, T>>(base);
+         axes_bounds_t<T, N> bounds{};
+         for (auto i = 0U; i < N; ++i) {
+            bounds[i] = searched[indices[i]];
+         }
+         return table.evaluate(bounds);
+      }
+
+      size_t add_search(const vector<T>& axis, const ExtrapolationPolicy& policy, size_t input, const T& uniform) {
+         for (auto s = 0U; s < std::size(searches); ++s) {
+            const auto& other = searches[s];
+            if (other.input == input
+               && other.policy.lower == policy.lower
+               && other.policy.upper == policy.upper
+               && (other.axis == &axis || *other.axis == axis)) {
+               return s;
+            }
+         }
+         searches.emplace_back(search{ &axis, policy, input, uniform });
+         return std::size(searches) - 1;
+      }
+
+      template<size_t N>
+      void add_entry(const table_map& map, const binding& binding) {
+         const auto& table = map.get<N, T>(binding.table);
+         entry e{ &table, &evaluate_entry<N> };
+         for (auto i = 0U; i < N; ++i) {
+            e.searches.emplace_back(add_search(table.axes[i], table.policies[i], binding.inputs[i], table.uniform[i]));
+         }
+         entries.emplace_back(std::move(e));
+      }
+
+   public:
+      lookup_plan() = default;
+
+      lookup_plan(const table_map& map, const vector<binding>& bindings) {
+         for (const auto& binding : bindings) {
+            const auto dims = std::size(binding.inputs);
+            const auto& maps = map.data();
+            if (!detail::contains(maps, dims) || !detail::contains(maps.at(dims), binding.table)) {
+               std::string msg = "No ";
+               msg += std::to_string(dims);
+               msg += "-D tables found containing ";
+               msg += binding.table;
+               msg += ".";
+               throw std::runtime_error(msg);
+            }
+            switch (dims) {
+            case 1:
+               add_entry<1>(map, binding);
+               break;
+            case 2:
+               add_entry<2>(map, binding);
+               break;
+            case 3:
+               add_entry<3>(map, binding);
+               break;
+            case 4:
+               add_entry<4>(map, binding);
+               break;
+            case 5:
+               add_entry<5>(map, binding);
+               break;
+            }
+         }
+      }
+
+      // number of results per state (one per binding)
+      size_t size() const {
+         return std::size(entries);
+      }
+
+      // distinct axis searches per state
+      size_t search_count() const {
+         return std::size(searches);
+      }
+
+      // the search results live in a per-thread scratch buffer (no allocation once warm)
+      void evaluate(const vector<T>& state, vector<T>& results) const {
+         static thread_local vector<bounds_t> searched{};
+         searched.resize(std::size(searches));
+         for (auto s = 0U; s < std::size(searches); ++s) {
+            const auto& search = searches[s];
+            search.run(searched[s], state[search.input]);
+         }
+         results.resize(std::size(entries));
+         for (auto j = 0U; j < std::size(entries); ++j) {
+            const auto& entry = entries[j];
+            results[j] = entry.evaluate(*entry.table, searched.data(), entry.searches.data());
+         }
+      }
+
+      void evaluate(const vector<vector<T>>& states,
+         vector<vector<T>>& results,
+         BatchMode mode = BatchMode::Merged) const {
+         const auto count = std::size(states);
+         const auto stride = std::size(searches);
+         vector<detail::axis_index<T>> indices(stride);
+         for (auto s = 0U; s < stride; ++s) {
+            const auto& search = searches[s];
+            indices[s].build(*search.axis, (mode == BatchMode::Merged) ? count : 0, search.uniform);
+         }
+         vector<bounds_t> searched(stride);
+         results.resize(count);
+         for (auto k = 0U; k < count; ++k) {
+            for (auto s = 0U; s < stride; ++s) {
+               const auto& search = searches[s];
+               indices[s].search(searched[s], search.policy, *search.axis, states[k][search.input]);
+            }
+            auto& result = results[k];
+            result.resize(std::size(entries));
+            for (auto j = 0U; j < std::size(entries); ++j) {
+               const auto& entry = entries[j];
+               result[j] = entry.evaluate(*entry.table, searched.data(), entry.searches.data());
+            }
+         }
+      }
+   };
+}
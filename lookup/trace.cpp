@@ -0,0 +1,264 @@
+#include "lookup/trace.h"
+#include <map>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <iterator>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <condition_variable>
+
+using namespace lookup;
+
+namespace {
+
+   using bytes_t = std::vector<char>;
+
+   constexpr char MAGIC[] = { 'L', 'K', 'T', 'R' };
+   constexpr std::uint32_t VERSION = 1;
+   constexpr unsigned char TABLE = 1;
+   constexpr unsigned char LOOKUP = 2;
+
+   template<class T>
+   void put(bytes_t& bytes, const T& value) {
+      const auto* first = reinterpret_cast<const char*>(&value);
+      bytes.insert(bytes.end(), first, first + sizeof(T));
+   }
+
+   template<class T>
+   T get(std::istream& is) {
+      T value{};
+      is.read(reinterpret_cast<char*>(&value), sizeof(T));
+      return value;
+   }
+
+   std::atomic<std::uint64_t> serials{ 0 };
+
+   struct buffer {
+      std::mutex mutex{};
+      bytes_t bytes{};
+      std::unordered_map<std::string, std::uint32_t> ids{};
+      std::string last{};          // table of the previous record (traces repeat tables in runs)
+      std::size_t last_dims = 0;
+      std::uint32_t last_id = 0;
+      std::size_t records = 0;
+      bool closed = false;
+   };
+
+   // a thread's buffers, one per writer (by serial); 'last' short-cuts the common case of a
+   // thread recording into the same writer as before
+   struct local_buffers {
+      std::uint64_t serial = 0;
+      std::shared_ptr<buffer> last{};
+      std::unordered_map<std::uint64_t, std::weak_ptr<buffer>> writers{};
+   };
+
+   thread_local local_buffers local{};
+}
+
+struct trace_writer::state {
+   const std::uint64_t serial = ++serials;
+   std::size_t buffer_size = 0;
+   std::ofstream out{};
+
+   std::mutex queue_mutex{};
+   std::condition_variable ready{};
+   std::deque<bytes_t> queue{};
+   bool stopping = false;
+   std::thread thread{};
+
+   std::mutex names_mutex{};
+   std::map<std::string, std::uint32_t> ids{};
+
+   std::mutex buffers_mutex{};
+   std::vector<std::shared_ptr<buffer>> buffers{};
+   bool closed = false;
+
+   void submit(bytes_t&& bytes) {
+      if (bytes.empty()) return;
+      {
+         std::lock_guard<std::mutex> lock(queue_mutex);
+         queue.emplace_back(std::move(bytes));
+      }
+      ready.notify_one();
+   }
+
+   void run() {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      for (;;) {
+         ready.wait(lock, [&]() { return stopping || !queue.empty(); });
+         while (!queue.empty()) {
+            auto bytes = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            lock.lock();
+         }
+         if (stopping) return;
+      }
+   }
+
+   std::shared_ptr<buffer> attach() {
+      auto result = std::make_shared<buffer>();
+      result->bytes.reserve(buffer_size + 256);
+      std::lock_guard<std::mutex> lock(buffers_mutex);
+      result->closed = closed;
+      buffers.emplace_back(result);
+      return result;
+   }
+
+   // assigns table ids; the table record is queued before any lookup can refer to it
+   std::uint32_t intern(const std::string& key, const std::string& table, std::size_t dims) {
+      std::lock_guard<std::mutex> lock(names_mutex);
+      const auto it = ids.find(key);
+      if (it != ids.end()) return it->second;
+      const auto id = static_cast<std::uint32_t>(ids.size());
+      ids.emplace(key, id);
+      bytes_t bytes{};
+      put(bytes, TABLE);
+      put(bytes, id);
+      put(bytes, static_cast<unsigned char>(dims));
+      put(bytes, static_cast<std::uint32_t>(table.size()));
+      bytes.insert(bytes.end(), table.begin(), table.end());
+      submit(std::move(bytes));
+      return id;
+   }
+};
+
+trace_writer::trace_writer(const std::string& path, std::size_t buffer_size)
+   : shared(std::make_shared<state>()) {
+   shared->buffer_size = buffer_size;
+   shared->out.open(path, std::ios::binary);
+   if (!shared->out) {
+      throw std::runtime_error("Unable to open trace file " + path + ".");
+   }
+   shared->out.write(MAGIC, sizeof(MAGIC));
+   shared->out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+   auto* target = shared.get();
+   shared->thread = std::thread([target]() { target->run(); });
+}
+
+trace_writer::~trace_writer() {
+   close();
+}
+
+void trace_writer::record(const std::string& table, const double* inputs, std::size_t dims) {
+   if (local.serial != shared->serial) {
+      auto& slot = local.writers[shared->serial];
+      auto found = slot.lock();
+      if (!found) {
+         found = shared->attach();
+         slot = found;
+         // forget writers that have been destroyed since
+         for (auto it = local.writers.begin(); it != local.writers.end();) {
+            it = it->second.expired() ? local.writers.erase(it) : std::next(it);
+         }
+      }
+      local.last = std::move(found);
+      local.serial = shared->serial;
+   }
+   auto& buf = *local.last;
+   std::lock_guard<std::mutex> lock(buf.mutex);
+   if (buf.closed) return;
+
+   if (buf.last_dims != dims || buf.last != table) {
+      auto key = table;
+      key += '\0';
+      key += static_cast<char>(dims);
+      auto it = buf.ids.find(key);
+      if (it == buf.ids.end()) {
+         it = buf.ids.emplace(key, shared->intern(key, table, dims)).first;
+      }
+      buf.last = table;
+      buf.last_dims = dims;
+      buf.last_id = it->second;
+   }
+   const auto size = std::size(buf.bytes);
+   buf.bytes.resize(size + 1 + sizeof(std::uint32_t) + (dims * sizeof(double)));
+   auto* out = buf.bytes.data() + size;
+   *out = static_cast<char>(LOOKUP);
+   std::memcpy(out + 1, &buf.last_id, sizeof(std::uint32_t));
+   std::memcpy(out + 1 + sizeof(std::uint32_t), inputs, dims * sizeof(double));
+   ++buf.records;
+   if (buf.bytes.size() >= shared->buffer_size) {
+      bytes_t full{};
+      full.reserve(shared->buffer_size + 256);
+      std::swap(full, buf.bytes);
+      shared->submit(std::move(full));
+   }
+}
+
+void trace_writer::close() {
+   {
+      std::lock_guard<std::mutex> lock(shared->buffers_mutex);
+      if (shared->closed) return;
+      shared->closed = true;
+      for (auto& buf : shared->buffers) {
+         std::lock_guard<std::mutex> buffer_lock(buf->mutex);
+         buf->closed = true;
+         shared->submit(std::move(buf->bytes));
+         buf->bytes = bytes_t{};
+      }
+   }
+   {
+      std::lock_guard<std::mutex> lock(shared->queue_mutex);
+      shared->stopping = true;
+   }
+   shared->ready.notify_one();
+   shared->thread.join();
+   shared->out.close();
+}
+
+std::size_t trace_writer::records() const {
+   std::size_t count = 0;
+   std::lock_guard<std::mutex> lock(shared->buffers_mutex);
+   for (const auto& buf : shared->buffers) {
+      std::lock_guard<std::mutex> buffer_lock(buf->mutex);
+      count += buf->records;
+   }
+   return count;
+}
+
+trace lookup::load_trace(const std::string& path) {
+   std::ifstream ifs(path, std::ios::binary);
+   char magic[sizeof(MAGIC)] = {};
+   ifs.read(magic, sizeof(magic));
+   if (!ifs || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || get<std::uint32_t>(ifs) != VERSION) {
+      throw std::runtime_error("Not a lookup trace: " + path + ".");
+   }
+
+   trace result{};
+   for (;;) {
+      const auto tag = ifs.get();
+      if (tag == std::char_traits<char>::eof()) break;
+      const auto id = get<std::uint32_t>(ifs);
+      if (tag == TABLE) {
+         const auto dims = get<unsigned char>(ifs);
+         std::string name(get<std::uint32_t>(ifs), '\0');
+         ifs.read(&name[0], static_cast<std::streamsize>(name.size()));
+         if (result.tables.size() <= id) {
+            result.tables.resize(id + 1);
+            result.dims.resize(id + 1);
+         }
+         result.tables[id] = name;
+         result.dims[id] = dims;
+      }
+      else if (tag == LOOKUP && id < result.dims.size()) {
+         result.ids.emplace_back(id);
+         result.offsets.emplace_back(result.inputs.size());
+         result.inputs.resize(result.inputs.size() + result.dims[id]);
+         ifs.read(reinterpret_cast<char*>(result.inputs.data() + result.offsets.back()),
+            static_cast<std::streamsize>(result.dims[id] * sizeof(double)));
+      }
+      else {
+         throw std::runtime_error("Corrupt lookup trace: " + path + ".");
+      }
+      if (!ifs) {
+         throw std::runtime_error("Truncated lookup trace: " + path + ".");
+      }
+   }
+   return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace lookup {
+
+   // binary query trace (host byte order):
+   //    header: "LKTR", u32 version
+   //    table:  u8 1, u32 id, u8 dims, u32 name length, name
+   //    lookup: u8 2, u32 id, dims x f64 inputs
+   // a table record always precedes the lookups referring to it
+   class trace_writer {
+   public:
+      // 'buffer_size': bytes buffered per thread before handing them to the writer thread
+      explicit trace_writer(const std::string& path, std::size_t buffer_size = std::size_t{ 1 } << 16);
+      // closes the file; detach the writer from every table_map first (table_map::trace)
+      ~trace_writer();
+
+      trace_writer(const trace_writer&) = delete;
+      trace_writer& operator=(const trace_writer&) = delete;
+
+      void record(const std::string& table, const double* inputs, std::size_t dims);
+
+      // flushes every thread's buffer and finishes the file; later records are dropped
+      void close();
+
+      std::size_t records() const;
+
+      struct state;
+
+   private:
+      std::shared_ptr<state> shared{};
+   };
+
+   struct trace {
+      std::vector<std::string> tables{};   // by table id
+      std::vector<std::size_t> dims{};     // by table id
+      std::vector<std::uint32_t> ids{};    // table id of every lookup
+      std::vector<std::size_t> offsets{};  // first input of every lookup in 'inputs'
+      std::vector<double> inputs{};
+
+      std::size_t size() const {
+         return ids.size();
+      }
+   };
+
+   trace load_trace(const std::string& path);
+}
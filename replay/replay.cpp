@@ -0,0 +1,288 @@
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+#include "lookup/json.h"
+#include "lookup/cache.hpp"
+#include "lookup/trace.h"
+
+namespace {
+
+   using namespace lookup;
+   using clock_t = std::chrono::steady_clock;
+   using records_t = std::vector<size_t>;
+   using strings_t = std::vector<std::string>;
+
+   struct Options {
+      std::vector<size_t> threads{ 1 };
+      strings_t strategies{ "direct", "cached", "merged", "independent" };
+      size_t capacity = 4096;
+      size_t batch = 256;
+   };
+
+   struct Run {
+      std::string strategy{};
+      size_t threads = 0;
+      double seconds = 0;
+      std::vector<double> latencies{};   // ns per lookup
+      std::vector<std::double_t> results{};
+   };
+
+   template<class T>
+   std::vector<T> split(const std::string& text, const std::function<T(const std::string&)>& parse) {
+      std::vector<T> values{};
+      std::istringstream is(text);
+      for (std::string item{}; std::getline(is, item, ',');) {
+         if (!item.empty()) {
+            values.emplace_back(parse(item));
+         }
+      }
+      return values;
+   }
+
+   // per-record evaluation of a trace entry, bound to one table
+   using evaluate_t = std::function<std::double_t(const std::double_t*)>;
+
+   template<size_t N, size_t... I>
+   evaluate_t direct(const table_map& map, const std::string& name, std::index_sequence<I...>) {
+      return [&map, &name](const std::double_t* x) {
+         return map.lookup(name, x[I]...);
+      };
+   }
+
+   template<size_t N, size_t... I>
+   evaluate_t cached(const table_map& map, const std::string& name, size_t capacity, std::index_sequence<I...>) {
+      auto cache = std::make_shared<cached_table<N>>(map, name, CachePolicy{ capacity });
+      return [cache](const std::double_t* x) {
+         return cache->lookup(x[I]...);
+      };
+   }
+
+   template<size_t N>
+   void batch(const table_map& map, const std::string& name, const trace& t,
+      const records_t& records, std::vector<std::double_t>& results, BatchMode mode) {
+      std::vector<array<std::double_t, N>> queries(records.size());
+      for (auto k = 0U; k < records.size(); ++k) {
+         std::copy_n(t.inputs.data() + t.offsets[records[k]], N, std::begin(queries[k]));
+      }
+      std::vector<std::double_t> values{};
+      map.lookup_batch(name, queries, values, mode);
+      for (auto k = 0U; k < records.size(); ++k) {
+         results[records[k]] = values[k];
+      }
+   }
+
+   using batch_t = void(*)(const table_map&, const std::string&, const trace&,
+      const records_t&, std::vector<std::double_t>&, BatchMode);
+
+   // one evaluator per table id, private to the calling thread
+   std::vector<evaluate_t> bind(const std::string& strategy, const table_map& map, const trace& t, const Options& options) {
+      std::vector<evaluate_t> evaluators{};
+      for (auto id = 0U; id < t.tables.size(); ++id) {
+         const auto& name = t.tables[id];
+         const auto is_direct = (strategy == "direct");
+         const auto capacity = options.capacity;
+         switch (t.dims[id]) {
+         case 1:
+            evaluators.emplace_back(is_direct ? direct<1>(map, name, std::make_index_sequence<1>{}) : cached<1>(map, name, capacity, std::make_index_sequence<1>{}));
+            break;
+         case 2:
+            evaluators.emplace_back(is_direct ? direct<2>(map, name, std::make_index_sequence<2>{}) : cached<2>(map, name, capacity, std::make_index_sequence<2>{}));
+            break;
+         case 3:
+            evaluators.emplace_back(is_direct ? direct<3>(map, name, std::make_index_sequence<3>{}) : cached<3>(map, name, capacity, std::make_index_sequence<3>{}));
+            break;
+         case 4:
+            evaluators.emplace_back(is_direct ? direct<4>(map, name, std::make_index_sequence<4>{}) : cached<4>(map, name, capacity, std::make_index_sequence<4>{}));
+            break;
+         case 5:
+            evaluators.emplace_back(is_direct ? direct<5>(map, name, std::make_index_sequence<5>{}) : cached<5>(map, name, capacity, std::make_index_sequence<5>{}));
+            break;
+         default:
+            throw std::runtime_error("Unsupported number of dimensions for " + name + ".");
+         }
+      }
+      return evaluators;
+   }
+
+   batch_t batch_function(size_t dims) {
+      switch (dims) {
+      case 1: return &batch<1>;
+      case 2: return &batch<2>;
+      case 3: return &batch<3>;
+      case 4: return &batch<4>;
+      case 5: return &batch<5>;
+      default: throw std::runtime_error("Unsupported number of dimensions.");
+      }
+   }
+
+   // replays records [begin, end) in trace order; batches group each window of 'options.batch'
+   // records by table, and every query of a batch is charged the batch time / batch size
+   void replay_range(const std::string& strategy, const table_map& map, const trace& t,
+      const Options& options, size_t begin, size_t end, Run& run) {
+      if (strategy == "direct" || strategy == "cached") {
+         const auto evaluators = bind(strategy, map, t, options);
+         for (auto k = begin; k < end; ++k) {
+            const auto start = clock_t::now();
+            run.results[k] = evaluators[t.ids[k]](t.inputs.data() + t.offsets[k]);
+            run.latencies[k] = std::chrono::duration<double, std::nano>(clock_t::now() - start).count();
+         }
+         return;
+      }
+      const auto mode = (strategy == "merged") ? BatchMode::Merged : BatchMode::Independent;
+      std::vector<records_t> groups(t.tables.size());
+      for (auto first = begin; first < end; first += options.batch) {
+         const auto last = std::min(first + options.batch, end);
+         for (auto k = first; k < last; ++k) {
+            groups[t.ids[k]].emplace_back(k);
+         }
+         for (auto id = 0U; id < groups.size(); ++id) {
+            auto& records = groups[id];
+            if (records.empty()) continue;
+            const auto start = clock_t::now();
+            batch_function(t.dims[id])(map, t.tables[id], t, records, run.results, mode);
+            const auto ns = std::chrono::duration<double, std::nano>(clock_t::now() - start).count();
+            for (const auto k : records) {
+               run.latencies[k] = ns / records.size();
+            }
+            records.clear();
+         }
+      }
+   }
+
+   Run replay(const std::string& strategy, size_t threads, const table_map& map, const trace& t, const Options& options) {
+      Run run{};
+      run.strategy = strategy;
+      run.threads = threads;
+      run.results.resize(t.size());
+      run.latencies.resize(t.size());
+
+      // contiguous shares keep each thread's slice of the trace in its recorded order
+      std::vector<std::thread> pool{};
+      std::mutex mutex{};
+      std::exception_ptr failure{};
+      const auto start = clock_t::now();
+      for (auto i = 0U; i < threads; ++i) {
+         const auto begin = (t.size() * i) / threads;
+         const auto end = (t.size() * (i + 1)) / threads;
+         pool.emplace_back([&, begin, end]() {
+            try {
+               replay_range(strategy, map, t, options, begin, end, run);
+            }
+            catch (...) {
+               std::lock_guard<std::mutex> lock(mutex);
+               if (!failure) failure = std::current_exception();
+            }
+         });
+      }
+      for (auto& thread : pool) {
+         thread.join();
+      }
+      run.seconds = std::chrono::duration<double>(clock_t::now() - start).count();
+      if (failure) {
+         std::rethrow_exception(failure);
+      }
+      return run;
+   }
+
+   double percentile(const std::vector<double>& sorted, double p) {
+      if (sorted.empty()) return 0;
+      const auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+      return sorted[index];
+   }
+
+   size_t mismatches(const Run& run, const Run& reference) {
+      size_t count = 0;
+      for (auto k = 0U; k < run.results.size(); ++k) {
+         const auto a = run.results[k];
+         const auto b = reference.results[k];
+         if (a != b && !(std::isnan(a) && std::isnan(b))) {
+            ++count;
+         }
+      }
+      return count;
+   }
+}
+
+int main(int argc, char** argv) {
+   if (argc < 3 || (argc % 2) != 1) {
+      std::ostringstream os{};
+      os << "Usage:\n";
+      os << "\tArg 1: Path to a table map (combined *.json, or CBOR when ending in .cbor).\n";
+      os << "\tArg 2: Path to a trace recorded with table_map::trace.\n";
+      os << "\t[--threads <n,...>]: Thread counts to replay with (default 1).\n";
+      os << "\t[--strategies <name,...>]: Any of direct, cached, merged, independent (default all).\n";
+      os << "\t[--cache <slots>]: Per-thread cache capacity of the cached strategy (default 4096).\n";
+      os << "\t[--batch <records>]: Trace window grouped into batches by the merged/independent strategies (default 256).";
+      throw std::runtime_error(os.str());
+   }
+
+   Options options{};
+   for (auto i = 3; i + 1 < argc; i += 2) {
+      const std::string option = argv[i];
+      const std::string value = argv[i + 1];
+      if (option == "--threads") {
+         options.threads = split<size_t>(value, [](const std::string& s) { return std::max<size_t>(std::stoul(s), 1); });
+      }
+      else if (option == "--strategies") {
+         options.strategies = split<std::string>(value, [](const std::string& s) { return s; });
+      }
+      else if (option == "--cache") {
+         options.capacity = std::stoul(value);
+      }
+      else if (option == "--batch") {
+         options.batch = std::max<size_t>(std::stoul(value), 1);
+      }
+      else {
+         throw std::runtime_error("Unknown option: " + option + " " + value);
+      }
+   }
+   for (const auto& strategy : options.strategies) {
+      if (strategy != "direct" && strategy != "cached" && strategy != "merged" && strategy != "independent") {
+         throw std::runtime_error("Unknown strategy: " + strategy);
+      }
+   }
+
+   const std::string map_path = argv[1];
+   const auto binary = map_path.size() > 5 && map_path.compare(map_path.size() - 5, 5, ".cbor") == 0;
+   const auto json = binary ? load_binary(map_path) : load_file(map_path);
+   table_map map{};
+   from_json(json, map);
+
+   const auto t = load_trace(argv[2]);
+   std::cout << t.size() << " lookups over " << t.tables.size() << " tables\n";
+
+   // every run is checked against the first one (first strategy, first thread count)
+   std::unique_ptr<Run> reference{};
+   std::cout << std::left << std::setw(12) << "strategy" << std::right << std::setw(8) << "threads";
+   std::cout << std::setw(14) << "lookups/s" << std::setw(10) << "p50 ns" << std::setw(10) << "p90 ns";
+   std::cout << std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns" << std::setw(12) << "mismatches" << "\n";
+   size_t failures = 0;
+   for (const auto& strategy : options.strategies) {
+      for (const auto threads : options.threads) {
+         auto run = replay(strategy, threads, map, t, options);
+         const auto wrong = reference ? mismatches(run, *reference) : 0;
+         failures += wrong;
+         auto sorted = run.latencies;
+         std::sort(std::begin(sorted), std::end(sorted));
+         std::cout << std::left << std::setw(12) << strategy << std::right << std::setw(8) << threads;
+         std::cout << std::setw(14) << std::fixed << std::setprecision(0) << (static_cast<double>(t.size()) / run.seconds);
+         std::cout << std::setprecision(1);
+         for (const auto p : { 0.5, 0.9, 0.99, 0.999 }) {
+            std::cout << std::setw(10) << percentile(sorted, p);
+         }
+         std::cout << std::setw(12) << wrong << "\n";
+         if (!reference) {
+            reference = std::make_unique<Run>(std::move(run));
+         }
+      }
+   }
+   if (failures > 0) {
+      std::cout << failures << " results differ between strategies\n";
+      return 1;
+   }
+   return 0;
+}